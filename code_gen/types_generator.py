@@ -13,15 +13,20 @@ fwd_classes = [
 	['status.h', ['enum class status_code : int','status']],
 	['status_return.h', ['template<class _StatusType, class _ValueType> class status_return']],
 	['', ['template<typename _Ty> using value_return = status_return<status, _Ty>;']],
-	['data_source.h', ['file_data_source']],
-	['data_destination.h', ['file_data_destination']],
-	['hasher.h', ['hasher_sha256', 'hasher_xxh64', 'hasher_xxh128', 'template <size_t _Size> class hasher_noop']],
-	['read_stream.h', ['template<class _DataSourceTy, class _HashTy = hasher_noop<64>> class read_stream']],
-	['write_stream.h', ['template<class _DataDestTy, class _HashTy = hasher_noop<64>> class write_stream']],
+	['data_source.h', ['file_data_source', 'mmap_data_source', 'memory_data_source', 'split_file_data_source']],
+	['data_destination.h', ['file_data_destination', 'memory_data_destination', 'split_file_data_destination']],
+	['hasher.h', ['hasher_sha256', 'hasher_sha256_native', 'hasher_xxh64', 'hasher_xxh128', 'template <size_t _Size> class hasher_noop']],
+	['hasher_tree.h', ['template<class _LeafHashTy = hasher_sha256_native> class hasher_tree']],
+	['tee_data_destination.h', ['template<class... _DataDestTys> class tee_data_destination']],
+	['sockets.h', ['socket_data_source', 'socket_data_destination']],
+	['task_worker.h', ['task_worker']],
+	['transform.h', ['transform_noop', 'transform_lz', 'transform_zstd']],
+	['read_stream.h', ['template<class _DataSourceTy, class _HashTy = hasher_noop<64>, class _TransformTy = transform_noop> class read_stream','enum class read_stream_flags : int']],
+	['write_stream.h', ['template<class _DataDestTy, class _HashTy = hasher_noop<64>, class _TransformTy = transform_noop> class write_stream','enum class write_stream_flags : int']],
 	['ntup.h', ['template<class _Ty, size_t _Size> class n_tup','template<class _Ty, size_t _InnerSize, size_t _OuterSize> class mn_tup']],
 	['bimap.h', ['template<class _Kty, class _Vty> class bimap']],
 	['bitmap_font.h', ['enum class bitmap_font_flags : int']],
-	['file_funcs.h', ['enum class access_mode : unsigned int','_file_object']],
+	['file_funcs.h', ['enum class access_mode : unsigned int','struct write_span','_file_object','file_io_batch']],
 	['digest.h', ['template<size_t _Size> struct digest']],
 	['uuid.h', ['struct uuid']],
 	['process.h', ['process']],
@@ -658,7 +663,7 @@ def generate_unit_tests_variants( test_path:str ):
 template<class _Ty> ctle::status _read_from_stream( ctle::read_stream<ctle::file_data_source,ctle::hasher_xxh128> &strm, std::vector<_Ty> &data )
 {
 	u32 cnt = 0;
-	ctle::status res = strm.read<u32>( &cnt, 1 );
+	ctle::status res = strm.read_varint<u32>( &cnt, 1 );
 	if( !res ) 
   		return res; 
 	data.resize(cnt);
@@ -667,7 +672,7 @@ template<class _Ty> ctle::status _read_from_stream( ctle::read_stream<ctle::file
 		
 template<class _Ty> ctle::status _write_to_stream( ctle::write_stream<ctle::file_data_destination,ctle::hasher_xxh128> &strm, const std::vector<_Ty> &data )
 {
-	ctle::status res = strm.write<u32>( (u32)data.size() );
+	ctle::status res = strm.write_varint<u32>( (u32)data.size() );
 	if( !res ) 
   		return res; 
 	return strm.write<_Ty>( data.data(), data.size() );
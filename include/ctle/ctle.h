@@ -20,6 +20,9 @@
 /// #include <vulkan/vulkan.h>	// convert vulkan errors to status errors
 /// #include <system_error>		// convert system errors to status errors
 /// #include <picosha2.h>		// hash calculation functions
+/// #define XXH_STATIC_LINKING_ONLY	// store the XXH3 hasher state in the hasher objects, instead of allocating it (define in all files which include ctle)
+/// #include <xxhash.h>			// xxHash XXH3 hash calculation functions, used by the XXH3 hashers, hash_once and hash_batch
+/// #include <zstd.h>			// zstd compression transform
 /// 
 /// // now, include ctle, which will implement the source code
 /// #include <ctle/ctle.h>
@@ -47,14 +50,19 @@
 #include "status_return.h"
 #include "string_funcs.h"
 #include "thread_safe_map.h"
+#include "task_worker.h"
 #include "util.h"
 #include "uuid.h"
+#include "varint.h"
 #include "digest.h"
 #include "sockets.h"
 #include "read_stream.h"
 #include "data_source.h"
 #include "data_destination.h"
+#include "tee_data_destination.h"
 #include "hasher.h"
+#include "hasher_tree.h"
+#include "transform.h"
 #include "process.h"
 
 #endif//_CTLE_CTLE_H_
\ No newline at end of file
@@ -20,7 +20,12 @@ namespace ctle
 class file_data_destination
 {
 public:
-	file_data_destination( const std::string &filepath, bool overwrite_existing = true );
+	/// @brief Open the file for writing
+	/// @param filepath the file path
+	/// @param overwrite_existing if false, the constructor throws if the file already exists
+	/// @param unbuffered if true, the file is written unbuffered, bypassing the OS page cache (see _file_object). Writes from the buffer of a 
+	/// write_stream are aligned, as long as the buffer size is a multiple of _file_object::unbuffered_alignment and no transform is used.
+	file_data_destination( const std::string &filepath, bool overwrite_existing = true, bool unbuffered = false );
 	~file_data_destination();
 
 	/// @brief Write from source buffer into file.
@@ -30,24 +35,116 @@ public:
 	/// @return status::ok, along with the number of bytes written, or an error status if the write failed.
 	status_return<status, u64> write(const u8* src_buffer, u64 write_count);
 
+	/// @brief Write a number of memory spans into the file, in order, in as few calls as possible. 
+	/// @details Implementing this method lets write_stream::write_gather write the stream buffer and the spans in a single call.
+	/// @param spans the spans to write
+	/// @param span_count the number of spans
+	/// @return status::ok, along with the number of bytes written, or an error status if the write failed.
+	status_return<status, u64> write_gather(const write_span* spans, size_t span_count);
+
 private:
 	_file_object file;
 };
 
+/// @brief Data destination object for writing data to a split file, which is a sequence of segment files of a fixed max size.
+/// @details The destination rolls over to a new segment file every segment_size bytes. The segments are named by 
+/// split_file_segment_path(), e.g. "archive.bin.000", "archive.bin.001", ..., and are read back as one stream by split_file_data_source.
+/// Each segment is a plain file, so segments can also be read separately, e.g. in parallel with separate streams.
+class split_file_data_destination
+{
+public:
+	/// @brief Create a split file destination, and open the first segment. 
+	/// @param _filepath the file path of the split file, which the segment index is appended to
+	/// @param _segment_size the max size of each segment in bytes
+	/// @param _overwrite_existing if true, any existing segments are removed, else the destination fails if a segment already exists
+	split_file_data_destination( const std::string &_filepath, u64 _segment_size, bool _overwrite_existing = true );
+	~split_file_data_destination();
+
+	/// @brief Write from source buffer into the segment files.
+	/// 
+	/// @param src_buffer the buffer to write from
+	/// @param write_count the number of bytes to write
+	/// @return status::ok, along with the number of bytes written, or an error status if the write failed.
+	status_return<status, u64> write(const u8* src_buffer, u64 write_count);
+
+	/// @brief Get the number of segment files which have been created
+	size_t get_segment_count() const { return this->segment_count; }
+
+private:
+	std::string filepath;
+	u64 segment_size = 0;
+	bool overwrite_existing = true;
+	size_t segment_count = 0;
+	u64 segment_position = 0;
+	_file_object file;
+
+	status open_next_segment();
+};
+
+/// @brief Data destination object for writing data to memory, e.g. to serialize objects for a network transfer.
+/// @details The destination either writes to a growable vector, which grows geometrically, or to a fixed size memory area (arena)
+/// supplied by the caller, in which case writing past the end of the arena fails with status::cant_write.
+class memory_data_destination
+{
+public:
+	/// @brief Create a destination which writes to a vector owned by the destination
+	memory_data_destination() : vector(&owned_vector) {}
+
+	/// @brief Create a destination which appends to a vector owned by the caller. The vector must stay valid for the lifetime of the destination.
+	memory_data_destination( std::vector<u8> &dest_vector ) : vector(&dest_vector) {}
+
+	/// @brief Create a destination which writes to a fixed size memory area owned by the caller. The memory must stay valid for the lifetime of the destination.
+	memory_data_destination( u8* _arena, u64 _arena_size ) : arena(_arena), arena_size(_arena_size) {}
+
+	memory_data_destination( const memory_data_destination & ) = delete;
+	memory_data_destination &operator=( const memory_data_destination & ) = delete;
+
+	/// @brief Write from source buffer into the memory.
+	/// 
+	/// @param src_buffer the buffer to write from
+	/// @param write_count the number of bytes to write
+	/// @return status::ok, along with the number of bytes written, or status::cant_write if the data does not fit in the arena.
+	status_return<status, u64> write(const u8* src_buffer, u64 write_count);
+
+	/// @brief Write a number of memory spans into the memory, in order, growing the vector at most once.
+	/// @param spans the spans to write
+	/// @param span_count the number of spans
+	/// @return status::ok, along with the number of bytes written, or status::cant_write if the data does not fit in the arena.
+	status_return<status, u64> write_gather(const write_span* spans, size_t span_count);
+
+	/// @brief Get a pointer to the written data
+	const u8* data() const { return ( this->vector ) ? this->vector->data() : this->arena; }
+
+	/// @brief Get the number of bytes in the destination memory
+	u64 size() const { return ( this->vector ) ? (u64)this->vector->size() : this->arena_position; }
+
+private:
+	std::vector<u8> owned_vector;
+	std::vector<u8>* vector = nullptr;
+	u8* arena = nullptr;
+	u64 arena_size = 0;
+	u64 arena_position = 0;
+
+	status reserve( u64 write_count );
+};
+
 }
 // namespace ctle
 
 #ifdef CTLE_IMPLEMENTATION
 
+#include <algorithm>
+#include <cstdio>
+
 #include "log.h"
 #include "_macros.inl"
 
 namespace ctle
 {
 
-file_data_destination::file_data_destination( const std::string &filepath, bool overwrite_existing )
+file_data_destination::file_data_destination( const std::string &filepath, bool overwrite_existing, bool unbuffered )
 {
-	ctStatusCallThrow(this->file.open_write(filepath,overwrite_existing));
+	ctStatusCallThrow(this->file.open_write(filepath,overwrite_existing,unbuffered));
 }
 
 file_data_destination::~file_data_destination()
@@ -65,6 +162,117 @@ status_return<status, u64> file_data_destination::write(const u8* src_buffer, u6
 	return write_count;
 }
 
+split_file_data_destination::split_file_data_destination( const std::string &_filepath, u64 _segment_size, bool _overwrite_existing )
+	: filepath(_filepath)
+	, segment_size(_segment_size)
+	, overwrite_existing(_overwrite_existing)
+{
+	ctValidate( this->segment_size > 0, status::invalid_param ) << "The segment size of a split file can not be 0" << ctValidateThrow;
+
+	// remove all existing segments, so that no segments of a previous split file are read back after the new segments
+	if( this->overwrite_existing )
+	{
+		for( size_t segment_index = 0; file_exists( split_file_segment_path( this->filepath, segment_index ) ); ++segment_index )
+		{
+			const std::string segment_path = split_file_segment_path( this->filepath, segment_index );
+			ctValidate( std::remove( segment_path.c_str() ) == 0, status::cant_write ) << "Failed to remove the existing segment " << segment_path << ctValidateThrow;
+		}
+	}
+
+	ctStatusCallThrow(this->open_next_segment());
+}
+
+split_file_data_destination::~split_file_data_destination()
+{
+	this->file.close();
+}
+
+status split_file_data_destination::open_next_segment()
+{
+	ctStatusCall(this->file.close());
+	ctStatusCall(this->file.open_write( split_file_segment_path( this->filepath, this->segment_count ), this->overwrite_existing ));
+	++this->segment_count;
+	this->segment_position = 0;
+	return status::ok;
+}
+
+status_return<status, u64> split_file_data_destination::write(const u8* src_buffer, u64 write_count)
+{
+	u64 written_bytes = 0;
+	while( written_bytes < write_count )
+	{
+		// roll over to the next segment when the current segment is full
+		if( this->segment_position >= this->segment_size )
+			ctStatusCall(this->open_next_segment());
+
+		const u64 to_write = std::min( write_count - written_bytes, this->segment_size - this->segment_position );
+		ctStatusCall(this->file.write(&src_buffer[written_bytes], to_write));
+		this->segment_position += to_write;
+		written_bytes += to_write;
+	}
+
+	return written_bytes;
+}
+
+status memory_data_destination::reserve( u64 write_count )
+{
+	if( this->vector )
+	{
+		// grow the vector geometrically, so that many small writes do not reallocate each time
+		const size_t required_size = this->vector->size() + (size_t)write_count;
+		if( required_size > this->vector->capacity() )
+			this->vector->reserve( std::max( required_size, this->vector->capacity() * 2 ) );
+	}
+	else
+	{
+		ctValidate( write_count <= this->arena_size - this->arena_position, status::cant_write ) << "The write of " << write_count << " bytes does not fit in the memory arena, " << ( this->arena_size - this->arena_position ) << " bytes are left" << ctValidateEnd;
+	}
+	return status::ok;
+}
+
+status_return<status, u64> memory_data_destination::write(const u8* src_buffer, u64 write_count)
+{
+	if( write_count > 0 )
+	{
+		ctStatusCall(this->reserve(write_count));
+		if( this->vector )
+		{
+			this->vector->insert( this->vector->end(), src_buffer, src_buffer + write_count );
+		}
+		else
+		{
+			memcpy( &this->arena[this->arena_position], src_buffer, (size_t)write_count );
+			this->arena_position += write_count;
+		}
+	}
+
+	return write_count;
+}
+
+status_return<status, u64> memory_data_destination::write_gather(const write_span* spans, size_t span_count)
+{
+	u64 write_count = 0;
+	for( size_t inx = 0; inx < span_count; ++inx )
+		write_count += spans[inx].size;
+
+	ctStatusCall(this->reserve(write_count));
+	for( size_t inx = 0; inx < span_count; ++inx )
+		ctStatusCall(this->write((const u8*)spans[inx].data, spans[inx].size).status());
+
+	return write_count;
+}
+
+status_return<status, u64> file_data_destination::write_gather(const write_span* spans, size_t span_count)
+{
+	u64 write_count = 0;
+	for( size_t inx = 0; inx < span_count; ++inx )
+		write_count += spans[inx].size;
+
+	ctStatusCall(this->file.write_gather(spans, span_count));
+
+	return write_count;
+}
+
 }
 // namespace ctle
 
@@ -20,7 +20,11 @@ namespace ctle
 class file_data_source
 {
 public:
-	file_data_source( const std::string &filepath );
+	/// @brief Open the file for reading
+	/// @param filepath the file path
+	/// @param unbuffered if true, the file is read unbuffered, bypassing the OS page cache (see _file_object). Reads into the buffer of a 
+	/// read_stream are aligned, as long as the buffer size is a multiple of _file_object::unbuffered_alignment and the stream is not seeked.
+	file_data_source( const std::string &filepath, bool unbuffered = false );
 	~file_data_source();
 
 	/// @brief read from source into dest_buffer, return number of bytes actually read
@@ -30,25 +34,147 @@ public:
 	/// @return status::ok, along with the number of bytes read, or an error status if the read failed.
 	status_return<status, u64> read(u8* dest_buffer, u64 read_count);
 
+	/// @brief Set the position in the file of the next read. The file is read using positional reads, so seeking does not touch the file.
+	/// @param position the new position, which can not be beyond the end of the file
+	/// @return status::ok, or status::invalid_param if the position is beyond the end of the file
+	status seek(u64 position);
+
+	/// @brief Get the size of the file
+	u64 size() const { return this->file.size(); }
+
 private:
 	u64 file_position = 0;
 	_file_object file;
 };
 
+/// @brief Data source object for reading data from a memory-mapped file. 
+/// @details The whole file is mapped read-only into memory on construction, and the mapping is advised for sequential access.
+/// The read method copies from the mapping, but since the data source is marked as memory mapped, read_stream will access 
+/// the mapped memory directly, and will not copy the data through its internal buffer (see read_stream::read_span).
+class mmap_data_source
+{
+public:
+	mmap_data_source( const std::string &filepath );
+	~mmap_data_source();
+
+	mmap_data_source( const mmap_data_source & ) = delete;
+	mmap_data_source &operator=( const mmap_data_source & ) = delete;
+
+	/// @brief Marks the source as memory mapped, so read_stream can use the mapped memory directly, through data() and size()
+	static constexpr bool is_memory_mapped = true;
+
+	/// @brief read from source into dest_buffer, return number of bytes actually read
+	/// 
+	/// @param dest_buffer the buffer to read into
+	/// @param read_count the number of bytes to read
+	/// @return status::ok, along with the number of bytes read, or an error status if the read failed.
+	status_return<status, u64> read(u8* dest_buffer, u64 read_count);
+
+	/// @brief Set the position in the file of the next read.
+	/// @param position the new position, which can not be beyond the end of the file
+	/// @return status::ok, or status::invalid_param if the position is beyond the end of the file
+	status seek(u64 position);
+
+	/// @brief Get a pointer to the start of the mapped file data. (nullptr if the file is empty)
+	const u8* data() const { return this->file_data; }
+
+	/// @brief Get the size of the mapped file data
+	u64 size() const { return this->file_size; }
+
+private:
+	u64 file_position = 0;
+	const u8* file_data = nullptr;
+	u64 file_size = 0;
+};
+
+/// @brief Data source object for reading a split file, written by split_file_data_destination, as one stream.
+/// @details The segments are found on construction, and are opened one at a time when read. The source is seekable over the whole 
+/// split file, so read_stream can seek, and read a block index, across the segments.
+class split_file_data_source
+{
+public:
+	/// @brief Create a split file source, and find the segments of the file.
+	/// @param _filepath the file path of the split file, which the segment index is appended to (see split_file_segment_path)
+	split_file_data_source( const std::string &_filepath );
+	~split_file_data_source();
+
+	/// @brief read from source into dest_buffer, return number of bytes actually read
+	/// 
+	/// @param dest_buffer the buffer to read into
+	/// @param read_count the number of bytes to read
+	/// @return status::ok, along with the number of bytes read, or an error status if the read failed.
+	status_return<status, u64> read(u8* dest_buffer, u64 read_count);
+
+	/// @brief Set the position in the split file of the next read.
+	/// @param position the new position, which can not be beyond the end of the split file
+	/// @return status::ok, or status::invalid_param if the position is beyond the end of the split file
+	status seek(u64 position);
+
+	/// @brief Get the total size of all segments
+	u64 size() const { return this->segment_offsets.back(); }
+
+	/// @brief Get the number of segments
+	size_t get_segment_count() const { return this->segment_offsets.size() - 1; }
+
+private:
+	std::string filepath;
+	std::vector<u64> segment_offsets; // the start offset of each segment, followed by the total size
+	u64 file_position = 0;
+	size_t open_segment = ~size_t(0);
+	_file_object file;
+};
+
+/// @brief Data source object for reading data from a memory area supplied by the caller, e.g. a received network message.
+/// @details The memory is not copied, and must stay valid for the lifetime of the data source. The data source is marked as 
+/// memory mapped, so read_stream reads directly from the memory, without copying the data through its internal buffer.
+class memory_data_source
+{
+public:
+	memory_data_source( const u8* _memory_data, u64 _memory_size ) : memory_data(_memory_data), memory_size(_memory_size) {}
+
+	/// @brief Marks the source as memory mapped, so read_stream can use the memory directly, through data() and size()
+	static constexpr bool is_memory_mapped = true;
+
+	/// @brief read from source into dest_buffer, return number of bytes actually read
+	/// 
+	/// @param dest_buffer the buffer to read into
+	/// @param read_count the number of bytes to read
+	/// @return status::ok, along with the number of bytes read, or an error status if the read failed.
+	status_return<status, u64> read(u8* dest_buffer, u64 read_count);
+
+	/// @brief Set the position in the memory of the next read.
+	/// @param position the new position, which can not be beyond the end of the memory
+	/// @return status::ok, or status::invalid_param if the position is beyond the end of the memory
+	status seek(u64 position);
+
+	/// @brief Get a pointer to the start of the memory
+	const u8* data() const { return this->memory_data; }
+
+	/// @brief Get the size of the memory
+	u64 size() const { return this->memory_size; }
+
+private:
+	u64 memory_position = 0;
+	const u8* memory_data = nullptr;
+	u64 memory_size = 0;
+};
+
 }
 // namespace ctle
 
 #ifdef CTLE_IMPLEMENTATION
 
+#include <algorithm>
+
 #include "log.h"
 #include "_macros.inl"
 
 namespace ctle
 {
 
-file_data_source::file_data_source( const std::string &filepath )
+file_data_source::file_data_source( const std::string &filepath, bool unbuffered )
 {
-	ctStatusCallThrow(this->file.open_read(filepath));
+	ctStatusCallThrow(this->file.open_read(filepath, unbuffered));
 }
 
 file_data_source::~file_data_source()
@@ -64,16 +190,204 @@ status_return<status, u64> file_data_source::read(u8* dest_buffer, u64 read_coun
 
 	if( read_size > 0 )
 	{
-		ctStatusCall(this->file.read(dest_buffer, read_size));
+		ctStatusCall(this->file.read_at(this->file_position, dest_buffer, read_size));
+		this->file_position += read_size;
+	}
+
+	return read_size;
+}
+
+status file_data_source::seek(u64 position)
+{
+	ctValidate( position <= (u64)this->file.size(), status::invalid_param ) << "The seek position " << position << " is beyond the end of the file" << ctValidateEnd;
+	this->file_position = position;
+	return status::ok;
+}
+
+status_return<status, u64> mmap_data_source::read(u8* dest_buffer, u64 read_count)
+{
+	// cap the read size to the size of the file
+	const u64 data_left = this->file_size - this->file_position;
+	const u64 read_size = std::min( read_count, data_left );
+
+	if( read_size > 0 )
+	{
+		memcpy( dest_buffer, &this->file_data[this->file_position], read_size );
 		this->file_position += read_size;
 	}
 
 	return read_size;
 }
 
+split_file_data_source::split_file_data_source( const std::string &_filepath )
+	: filepath(_filepath)
+{
+	// find the segments, and their sizes
+	this->segment_offsets.push_back( 0 );
+	for( size_t segment_index = 0; file_exists( split_file_segment_path( this->filepath, segment_index ) ); ++segment_index )
+	{
+		ctStatusCallThrow(this->file.open_read( split_file_segment_path( this->filepath, segment_index ) ));
+		this->segment_offsets.push_back( this->segment_offsets.back() + this->file.size() );
+		ctStatusCallThrow(this->file.close());
+	}
+	ctValidate( this->segment_offsets.size() > 1, status::cant_open ) << "Found no segments of the split file " << this->filepath << ctValidateThrow;
+}
+
+split_file_data_source::~split_file_data_source()
+{
+	this->file.close();
+}
+
+status_return<status, u64> split_file_data_source::read(u8* dest_buffer, u64 read_count)
+{
+	// cap the read size to the size of the split file
+	const u64 read_size = std::min( read_count, this->size() - this->file_position );
+
+	u64 read_bytes = 0;
+	while( read_bytes < read_size )
+	{
+		// find the segment which holds the current position, (skipping any empty segments) and open it if needed
+		const size_t segment_index = (size_t)( std::upper_bound( this->segment_offsets.begin(), this->segment_offsets.end(), this->file_position ) - this->segment_offsets.begin() ) - 1;
+		const u64 segment_start = this->segment_offsets[segment_index];
+		const u64 segment_end = this->segment_offsets[segment_index + 1];
+		if( segment_index != this->open_segment )
+		{
+			ctStatusCall(this->file.close());
+			ctStatusCall(this->file.open_read( split_file_segment_path( this->filepath, segment_index ) ));
+			ctValidate( this->file.size() == segment_end - segment_start, status::corrupted ) << "The size of segment " << segment_index << " of the split file " << this->filepath << " has changed" << ctValidateEnd;
+			this->open_segment = segment_index;
+		}
+
+		const u64 to_read = std::min( read_size - read_bytes, segment_end - this->file_position );
+		ctStatusCall(this->file.read_at( this->file_position - segment_start, &dest_buffer[read_bytes], to_read ));
+		this->file_position += to_read;
+		read_bytes += to_read;
+	}
+
+	return read_bytes;
+}
+
+status split_file_data_source::seek(u64 position)
+{
+	ctValidate( position <= this->size(), status::invalid_param ) << "The seek position " << position << " is beyond the end of the split file" << ctValidateEnd;
+	this->file_position = position;
+	return status::ok;
+}
+
+status_return<status, u64> memory_data_source::read(u8* dest_buffer, u64 read_count)
+{
+	// cap the read size to the size of the memory
+	const u64 data_left = this->memory_size - this->memory_position;
+	const u64 read_size = std::min( read_count, data_left );
+
+	if( read_size > 0 )
+	{
+		memcpy( dest_buffer, &this->memory_data[this->memory_position], read_size );
+		this->memory_position += read_size;
+	}
+
+	return read_size;
+}
+
+status memory_data_source::seek(u64 position)
+{
+	ctValidate( position <= this->memory_size, status::invalid_param ) << "The seek position " << position << " is beyond the end of the memory" << ctValidateEnd;
+	this->memory_position = position;
+	return status::ok;
+}
+
+status mmap_data_source::seek(u64 position)
+{
+	ctValidate( position <= this->file_size, status::invalid_param ) << "The seek position " << position << " is beyond the end of the file" << ctValidateEnd;
+	this->file_position = position;
+	return status::ok;
+}
+
 }
 // namespace ctle
 
+#if defined(_WIN32)
+
+#define _ADD_CTLE_HEADERS_WIN_STD
+#include "os.inl"
+
+namespace ctle
+{
+
+mmap_data_source::mmap_data_source( const std::string &filepath )
+{
+	// convert the utf8 string to wstring fullpath for the API call
+	const auto wpath = utf8string_to_wstringfullpath(filepath);
+
+	windows_handle_ref file_handle( ::CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) );
+	ctValidate( file_handle.get_handle() != INVALID_HANDLE_VALUE, status::cant_open ) << "Failed to open file " << filepath << ctValidateThrow;
+
+	LARGE_INTEGER dfilesize = {};
+	ctValidate( ::GetFileSizeEx(file_handle.get_handle(), &dfilesize), status::corrupted ) << "Failed to get the size of file " << filepath << ctValidateThrow;
+	this->file_size = (u64)dfilesize.QuadPart;
+
+	// an empty file can't be mapped, leave the data pointer as nullptr
+	if( this->file_size == 0 )
+		return;
+
+	// map the whole file. the view is kept alive after the handles are closed
+	windows_handle_ref mapping_handle( ::CreateFileMappingW(file_handle.get_handle(), nullptr, PAGE_READONLY, 0, 0, nullptr) );
+	ctValidate( mapping_handle.get_handle() != nullptr, status::cant_read ) << "Failed to create a file mapping of file " << filepath << ctValidateThrow;
+
+	this->file_data = (const u8*)::MapViewOfFile(mapping_handle.get_handle(), FILE_MAP_READ, 0, 0, 0);
+	ctValidate( this->file_data != nullptr, status::cant_read ) << "Failed to map a view of file " << filepath << ctValidateThrow;
+}
+
+mmap_data_source::~mmap_data_source()
+{
+	if( this->file_data )
+		::UnmapViewOfFile( this->file_data );
+}
+
+}
+// namespace ctle
+
+#elif defined(__linux__)
+
+#define _ADD_CTLE_HEADERS_LINUX_STD
+#include "os.inl"
+
+namespace ctle
+{
+
+mmap_data_source::mmap_data_source( const std::string &filepath )
+{
+	linux_file_ref file_handle( ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC) );
+	ctValidate( file_handle.get_handle() != -1, status::cant_open ) << "Failed to open file " << filepath << ctValidateThrow;
+
+	struct stat file_stat = {};
+	ctValidate( ::fstat(file_handle.get_handle(), &file_stat) == 0, status::corrupted ) << "Failed to get the size of file " << filepath << ctValidateThrow;
+	this->file_size = (u64)file_stat.st_size;
+
+	// an empty file can't be mapped, leave the data pointer as nullptr
+	if( this->file_size == 0 )
+		return;
+
+	// map the whole file. the mapping is kept alive after the file is closed
+	void *mapping = ::mmap(nullptr, (size_t)this->file_size, PROT_READ, MAP_PRIVATE, file_handle.get_handle(), 0);
+	ctValidate( mapping != MAP_FAILED, status::cant_read ) << "Failed to memory map file " << filepath << ctValidateThrow;
+	this->file_data = (const u8*)mapping;
+
+	// the data is mostly streamed from start to end, so hint the kernel to read ahead aggressively
+	::madvise(mapping, (size_t)this->file_size, MADV_SEQUENTIAL);
+}
+
+mmap_data_source::~mmap_data_source()
+{
+	if( this->file_data )
+		::munmap( (void*)this->file_data, (size_t)this->file_size );
+}
+
+}
+// namespace ctle
+
+#endif// defined(_WIN32) elif defined(__linux__)
+
 #include "_undef_macros.inl"
 
 #endif//CTLE_IMPLEMENTATION
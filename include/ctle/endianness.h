@@ -9,8 +9,34 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <utility>
+#include <type_traits>
+
+// select the SIMD instruction set used by the bulk byte order swaps at compile time
+#if defined(__AVX2__)
+#define _CTLE_SWAP_BYTE_ORDER_AVX2
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#define _CTLE_SWAP_BYTE_ORDER_SSSE3
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define _CTLE_SWAP_BYTE_ORDER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define _CTLE_SWAP_BYTE_ORDER_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+// detect big-endian hosts at compile time (MSVC only targets little-endian platforms)
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && ( __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ )
+#define _CTLE_BIG_ENDIAN_HOST
+#endif
 
 namespace ctle
 {
@@ -132,17 +158,202 @@ template<> inline void swap_byte_order<uint64_t>( uint64_t *dest )
 template <class T> void swap_byte_order( T *dest, size_t count );
 
 
+/// @brief Returns a value with swapped byte order. Overloads are implemented for uint8_t, uint16_t, uint32_t, and uint64_t.
+/// @param value The value to swap byte order of.
+/// @return The value with swapped byte order. (For uint8_t, this is the same value.)
+inline uint8_t swapped_byte_order( uint8_t value )
+{
+    return value;
+}
+
+/// @brief Returns a value with swapped byte order. Overload for uint16_t.
+/// @param value The value to swap byte order of.
+/// @return The value with swapped byte order.
+inline uint16_t swapped_byte_order( uint16_t value )
+{
+#if defined(_MSC_VER)
+    return _byteswap_ushort( value );
+#elif defined(__GNUC__)
+    return __builtin_bswap16( value );
+#else
+    return uint16_t( ( value >> 8 ) | ( value << 8 ) );
+#endif
+}
+
+/// @brief Returns a value with swapped byte order. Overload for uint32_t.
+/// @param value The value to swap byte order of.
+/// @return The value with swapped byte order.
+inline uint32_t swapped_byte_order( uint32_t value )
+{
+#if defined(_MSC_VER)
+    return _byteswap_ulong( value );
+#elif defined(__GNUC__)
+    return __builtin_bswap32( value );
+#else
+    return ( value >> 24 ) 
+        | ( ( value >> 8 ) & uint32_t( 0x0000ff00 ) ) 
+        | ( ( value << 8 ) & uint32_t( 0x00ff0000 ) ) 
+        | ( value << 24 );
+#endif
+}
+
+/// @brief Returns a value with swapped byte order. Overload for uint64_t.
+/// @param value The value to swap byte order of.
+/// @return The value with swapped byte order.
+inline uint64_t swapped_byte_order( uint64_t value )
+{
+#if defined(_MSC_VER)
+    return _byteswap_uint64( value );
+#elif defined(__GNUC__)
+    return __builtin_bswap64( value );
+#else
+    return ( uint64_t( swapped_byte_order( uint32_t( value & 0xffffffff ) ) ) << 32 ) | uint64_t( swapped_byte_order( uint32_t( value >> 32 ) ) );
+#endif
+}
+
+/// @brief The unsigned integer type which has the same size as a value, and is used to swap the byte order of the value. 
+/// @details Defined for sizes 1, 2, 4 and 8, which makes it possible to swap the byte order of any trivially copyable type of these sizes, such as float or int32_t.
+/// @tparam _Size The size of the value in bytes.
+template <size_t _Size> struct byte_order_swap_type {};
+template <> struct byte_order_swap_type<1> { using type = uint8_t; };
+template <> struct byte_order_swap_type<2> { using type = uint16_t; };
+template <> struct byte_order_swap_type<4> { using type = uint32_t; };
+template <> struct byte_order_swap_type<8> { using type = uint64_t; };
+
+/// @brief Returns the byte shuffle mask which swaps the byte order of values of _Size bytes, in 32 bytes of data.
+template <size_t _Size> inline const uint8_t *_swap_byte_order_shuffle_mask()
+{
+    static const uint8_t masks[3][32] = {
+        { 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14 },
+        { 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12 },
+        { 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8 },
+    };
+    return masks[ ( _Size == 2 ) ? 0 : ( ( _Size == 4 ) ? 1 : 2 ) ];
+}
+
+#if defined(_CTLE_SWAP_BYTE_ORDER_SSE2)
+// SSE2 has no byte shuffle, so swap the bytes in 16-bit words with shifts, and shuffle the words for the larger types
+inline __m128i _swap_byte_order_sse2( __m128i value, std::integral_constant<size_t, 2> ) 
+{ 
+    return _mm_or_si128( _mm_slli_epi16( value, 8 ), _mm_srli_epi16( value, 8 ) ); 
+}
+inline __m128i _swap_byte_order_sse2( __m128i value, std::integral_constant<size_t, 4> ) 
+{ 
+    value = _mm_shufflehi_epi16( _mm_shufflelo_epi16( value, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    return _swap_byte_order_sse2( value, std::integral_constant<size_t, 2>() );
+}
+inline __m128i _swap_byte_order_sse2( __m128i value, std::integral_constant<size_t, 8> ) 
+{ 
+    value = _mm_shufflehi_epi16( _mm_shufflelo_epi16( value, _MM_SHUFFLE( 0, 1, 2, 3 ) ), _MM_SHUFFLE( 0, 1, 2, 3 ) );
+    return _swap_byte_order_sse2( value, std::integral_constant<size_t, 2>() );
+}
+#endif
+
+#if defined(_CTLE_SWAP_BYTE_ORDER_NEON)
+inline uint8x16_t _swap_byte_order_neon( uint8x16_t value, std::integral_constant<size_t, 2> ) { return vrev16q_u8( value ); }
+inline uint8x16_t _swap_byte_order_neon( uint8x16_t value, std::integral_constant<size_t, 4> ) { return vrev32q_u8( value ); }
+inline uint8x16_t _swap_byte_order_neon( uint8x16_t value, std::integral_constant<size_t, 8> ) { return vrev64q_u8( value ); }
+#endif
+
+/// @brief Copies and swaps the byte order of as many whole SIMD blocks of values as possible, using the instruction set selected 
+/// at compile time (AVX2, SSSE3, SSE2 or NEON). Returns the number of values which were swapped, the rest are left to the caller.
+template <class T> inline size_t _copy_swap_byte_order_simd( uint8_t *dest, const uint8_t *src, size_t count )
+{
+    size_t i = 0;
+#if defined(_CTLE_SWAP_BYTE_ORDER_AVX2)
+    const size_t block_count = 32 / sizeof( T );
+    const __m256i mask = _mm256_loadu_si256( (const __m256i *)_swap_byte_order_shuffle_mask<sizeof( T )>() );
+    for( ; i + block_count <= count; i += block_count )
+    {
+        const __m256i value = _mm256_loadu_si256( (const __m256i *)&src[i * sizeof( T )] );
+        _mm256_storeu_si256( (__m256i *)&dest[i * sizeof( T )], _mm256_shuffle_epi8( value, mask ) );
+    }
+#elif defined(_CTLE_SWAP_BYTE_ORDER_SSSE3)
+    const size_t block_count = 16 / sizeof( T );
+    const __m128i mask = _mm_loadu_si128( (const __m128i *)_swap_byte_order_shuffle_mask<sizeof( T )>() );
+    for( ; i + block_count <= count; i += block_count )
+    {
+        const __m128i value = _mm_loadu_si128( (const __m128i *)&src[i * sizeof( T )] );
+        _mm_storeu_si128( (__m128i *)&dest[i * sizeof( T )], _mm_shuffle_epi8( value, mask ) );
+    }
+#elif defined(_CTLE_SWAP_BYTE_ORDER_SSE2)
+    const size_t block_count = 16 / sizeof( T );
+    for( ; i + block_count <= count; i += block_count )
+    {
+        const __m128i value = _mm_loadu_si128( (const __m128i *)&src[i * sizeof( T )] );
+        _mm_storeu_si128( (__m128i *)&dest[i * sizeof( T )], _swap_byte_order_sse2( value, std::integral_constant<size_t, sizeof( T )>() ) );
+    }
+#elif defined(_CTLE_SWAP_BYTE_ORDER_NEON)
+    const size_t block_count = 16 / sizeof( T );
+    for( ; i + block_count <= count; i += block_count )
+    {
+        const uint8x16_t value = vld1q_u8( &src[i * sizeof( T )] );
+        vst1q_u8( &dest[i * sizeof( T )], _swap_byte_order_neon( value, std::integral_constant<size_t, sizeof( T )>() ) );
+    }
+#else
+    (void)dest;
+    (void)src;
+    (void)count;
+#endif
+    return i;
+}
+
+// single byte values have no byte order to swap, so they are just copied
+template <class T> inline void _copy_swap_byte_order( uint8_t *dest, const uint8_t *src, size_t count, std::integral_constant<size_t, 1> )
+{
+    if( dest != src && count > 0 )
+        memcpy( dest, src, count );
+}
+
+// swaps the bulk of the values with SIMD instructions, and the remaining values with byte swap instructions
+template <class T, size_t _Size> inline void _copy_swap_byte_order( uint8_t *dest, const uint8_t *src, size_t count, std::integral_constant<size_t, _Size> )
+{
+    const size_t simd_count = _copy_swap_byte_order_simd<T>( dest, src, count );
+    for( size_t i = simd_count; i < count; ++i )
+    {
+        T value;
+        memcpy( &value, &src[i * sizeof( T )], sizeof( T ) );
+        value = swapped_byte_order( value );
+        memcpy( &dest[i * sizeof( T )], &value, sizeof( T ) );
+    }
+}
+
+/// @brief Copy multiple values, and swap the byte order of the values while copying. Implemented for uint8_t, uint16_t, uint32_t, and uint64_t.
+/// @details Copying and swapping in the same pass only touches the data once, compared to copying and then swapping the byte order in place.
+/// The source and destination do not need to be aligned. The source and destination can be the same memory area (an in-place swap), but must not partially overlap.
+/// The bulk of the values are swapped with SIMD instructions (AVX2, SSSE3, SSE2 or NEON, selected at compile time), and the remaining values with byte swap instructions.
+/// @tparam T The type of the values to copy and swap byte order.
+/// @param dest Pointer to the destination memory, with room for count values.
+/// @param src Pointer to the source values.
+/// @param count The number of values to copy.
+template <class T> void copy_swap_byte_order( void *dest, const void *src, size_t count )
+{
+    _copy_swap_byte_order<T>( (uint8_t *)dest, (const uint8_t *)src, count, std::integral_constant<size_t, sizeof( T )>() );
+}
+
+/// @brief Copy multiple values between the native byte order of the host and big-endian byte order (the conversion is the same in both directions).
+/// @details On little-endian hosts, the byte order is swapped while copying (see copy_swap_byte_order). On big-endian hosts, the values are copied as is.
+/// @tparam T The type of the values to copy, uint8_t, uint16_t, uint32_t or uint64_t.
+/// @param dest Pointer to the destination memory, with room for count values.
+/// @param src Pointer to the source values.
+/// @param count The number of values to copy.
+template <class T> void copy_bigendian( void *dest, const void *src, size_t count )
+{
+#if defined(_CTLE_BIG_ENDIAN_HOST)
+    if( dest != src )
+        memcpy( dest, src, count * sizeof( T ) );
+#else
+    copy_swap_byte_order<T>( dest, src, count );
+#endif
+}
+
 /// @brief Swap byte order of multiple values. Specialization for uint16_t.
 /// 
 /// @param dest Pointer to the array of uint16_t values to swap byte order.
 /// @param count The number of values in the array.
 template<> inline void swap_byte_order<uint16_t>( uint16_t *dest, size_t count )
 {
-    for( size_t i = 0; i < count; ++i )
-    {
-        swap_bytes( &( (uint8_t *)dest )[0], &( (uint8_t *)dest )[1] );
-        ++dest;
-    }
+    copy_swap_byte_order<uint16_t>( dest, dest, count );
 }
 
 /// @brief Swap byte order of multiple values. Specialization for uint32_t.
@@ -151,12 +362,7 @@ template<> inline void swap_byte_order<uint16_t>( uint16_t *dest, size_t count )
 /// @param count The number of values in the array.
 template<> inline void swap_byte_order<uint32_t>( uint32_t *dest, size_t count )
 {
-    for( size_t i = 0; i < count; ++i )
-    {
-        swap_bytes( &( (uint8_t *)dest )[0], &( (uint8_t *)dest )[3] );
-        swap_bytes( &( (uint8_t *)dest )[1], &( (uint8_t *)dest )[2] );
-        ++dest;
-    }
+    copy_swap_byte_order<uint32_t>( dest, dest, count );
 }
 
 /// @brief Swap byte order of multiple values. Specialization for uint64_t.
@@ -165,14 +371,7 @@ template<> inline void swap_byte_order<uint32_t>( uint32_t *dest, size_t count )
 /// @param count The number of values in the array.
 template<> inline void swap_byte_order<uint64_t>( uint64_t *dest, size_t count )
 {
-    for( size_t i = 0; i < count; ++i )
-    {
-        swap_bytes( &( (uint8_t *)dest )[0], &( (uint8_t *)dest )[7] );
-        swap_bytes( &( (uint8_t *)dest )[1], &( (uint8_t *)dest )[6] );
-        swap_bytes( &( (uint8_t *)dest )[2], &( (uint8_t *)dest )[5] );
-        swap_bytes( &( (uint8_t *)dest )[3], &( (uint8_t *)dest )[4] );
-        ++dest;
-    }
+    copy_swap_byte_order<uint64_t>( dest, dest, count );
 }
 
 }
@@ -11,9 +11,12 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <memory>
 
 #include "fwd.h"
 #include "status.h"
+#include "status_error.h"
+#include "task_worker.h"
 
 namespace ctle
 {
@@ -53,66 +56,160 @@ status file_access(const std::string& path, access_mode amode); ///< @copydoc ct
 /// - status::cant_read if the file could not be read
 status read_file(const std::string & filepath, std::vector<uint8_t>&dest);
 
+/// @brief Read multiple files in binary mode into vectors of bytes, in parallel. 
+/// @details The files are opened, sized and read by a number of worker threads. Each thread reads its files in batches, using a 
+/// file_io_batch (which uses io_uring if available), so that reading many small files is not bound by the latency of each read.
+/// @param filepaths the source file paths
+/// @param dest the destination vectors, which is resized to the number of files
+/// @param file_status receives the status of each file, using the same status codes as read_file()
+/// @param thread_count the number of worker threads, if 0 the number of hardware threads is used
+/// @return status::ok if all files were read successfully, else the status of the first file which failed
+status read_files(const std::vector<std::string> &filepaths, std::vector<std::vector<uint8_t>> &dest, std::vector<status> &file_status, size_t thread_count = 0);
+
+/// @brief Read multiple files in binary mode into vectors of bytes, in parallel. 
+/// @copydetails ctle::read_files(const std::vector<std::string>&, std::vector<std::vector<uint8_t>>&, std::vector<status>&, size_t)
+/// @param filepaths the source file paths
+/// @param dest the destination vectors, which is resized to the number of files
+/// @param thread_count the number of worker threads, if 0 the number of hardware threads is used
+/// @return status::ok if all files were read successfully, else the status of the first file which failed
+status read_files(const std::vector<std::string> &filepaths, std::vector<std::vector<uint8_t>> &dest, size_t thread_count = 0);
+
 /// @brief Write a file in binary mode from a pointer to or a container.
+/// @details The disk space of the file is preallocated before writing, so that large files are not fragmented.
 /// @param filepath the destination file path
 /// @param src the source data 
 /// @param src_size the source data size
 /// @param overwrite_existing if false, the file will not be overwritten if it already exists, and the function will return status::already_exists
+/// @param atomic if true, the data is written to a temporary file, which is synced to disk and then renamed to the file path, so the 
+/// file is either fully written or not changed at all, even if the process or system crashes (see _file_object::open_write_atomic)
 /// @return 
 /// - status::ok if the file was written successfully
 /// - status::cant_write if the file could not be written
 /// - status::already_exists if the file already exists and overwrite_existing is false
-status write_file(const std::string& filepath, const void* src, size_t src_size, bool overwrite_existing = false);
+status write_file(const std::string& filepath, const void* src, size_t src_size, bool overwrite_existing = false, bool atomic = false);
 
 /// @brief Write a file in binary mode from a pointer to or a container.
 /// @tparam _Ty the type of the source data(container)
 /// @param filepath the destination file path
 /// @param src the source data 
 /// @param overwrite_existing if false, the file will not be overwritten if it already exists, and the function will return status::already_exists
+/// @param atomic if true, the file is written atomically (see write_file)
 /// @return 
 /// - status::ok if the file was written successfully
 /// - status::cant_write if the file could not be written
 /// - status::already_exists if the file already exists and overwrite_existing is false
-template<class _Ty> inline status write_file(const std::string& filepath, const _Ty& src, bool overwrite_existing = false)
+template<class _Ty> inline status write_file(const std::string& filepath, const _Ty& src, bool overwrite_existing = false, bool atomic = false)
 {
-	return write_file( filepath, (const void *)src.data(), src.size() * sizeof( typename _Ty::value_type ), overwrite_existing );
+	return write_file( filepath, (const void *)src.data(), src.size() * sizeof( typename _Ty::value_type ), overwrite_existing, atomic );
 }
 
+/// @brief Get the file path of a segment of a split file, which is the file path with the segment index appended as an extension 
+/// of at least 3 digits, e.g. "archive.bin.000", "archive.bin.001", ... (See split_file_data_destination and split_file_data_source)
+/// @param filepath the file path of the split file
+/// @param segment_index the index of the segment
+/// @return the file path of the segment
+std::string split_file_segment_path(const std::string& filepath, size_t segment_index);
+
+/// @brief A span of bytes to write, used for gather writes, which write multiple spans of memory in a single call.
+/// (See _file_object::write_gather and write_stream::write_gather)
+struct write_span
+{
+	const void* data;
+	size_t size;
+};
+
 /// @brief Class for file reading/writing, encapsulating a file object.
 /// @details This class is portable, but uses native interfaces when possible. Mainly for internal use, but can be used directly.
+/// Files can be opened in unbuffered mode, which bypasses the OS page cache (O_DIRECT on Linux, FILE_FLAG_NO_BUFFERING on Windows),
+/// for large sequential transfers which should not evict other data from the cache. Unbuffered transfers must have the memory address,
+/// size and file position aligned to unbuffered_alignment. The first transfer which is not aligned (such as the tail of a file) switches 
+/// the file to buffered mode, so all transfers succeed, but only the aligned transfers before the switch bypass the cache. 
+/// Switching mode is not synchronized with transfers running on other threads.
 class _file_object
 {
 private:
+#if defined(_WIN32)
 	void* file_handle = nullptr;
+	unsigned long file_access = 0;
+#else
+	int file_descriptor = -1;
+#endif
 	u64 file_size = 0;
+	bool unbuffered = false;
+
+	// the paths of an atomic write, which is written to the temp file, and renamed to the target on close
+	std::string atomic_temp_path;
+	std::string atomic_target_path;
+	bool atomic_overwrite_existing = false;
+
+	friend class file_io_batch;
+
+	static bool is_unbuffered_aligned(const u64 offset, const void* data, const u64 size);
+	bool make_buffered();
+	void close_file();
+	status sync();
+	status commit_atomic_write();
+	void discard_atomic_write();
 	
 public:
+	/// @brief The alignment of the memory, sizes and file positions of transfers in unbuffered mode.
+	static constexpr size_t unbuffered_alignment = 4096;
+
 	_file_object();
 	~_file_object();
 
 	/// @brief Open a file for reading
 	/// @param filepath the file path
+	/// @param unbuffered if true, open the file in unbuffered mode, if supported by the file system (see is_unbuffered)
 	/// @return 
 	/// - status::ok if the file was opened successfully
 	/// - status::cant_open if the file could not be opened
 	/// - status::corrupted if the file size could not be determined
-	status open_read(const std::string & filepath);
+	status open_read(const std::string & filepath, bool unbuffered = false);
 
 	/// @brief Open a file for writing
 	/// @param filepath the file path
 	/// @param overwrite_existing if false, the file will not be overwritten if it already exists, and the function will return status::already_exists
+	/// @param unbuffered if true, open the file in unbuffered mode, if supported by the file system (see is_unbuffered)
 	/// @return 
 	/// - status::ok if the file was opened successfully
 	/// - status::cant_write if the file could not be opened
 	/// - status::already_exists if the file already exists and overwrite_existing is false
-	status open_write(const std::string & filepath, bool overwrite_existing = false);
+	status open_write(const std::string & filepath, bool overwrite_existing = false, bool unbuffered = false);
+
+	/// @brief Open a file for an atomic write. The data is written to a new temporary file next to the file path, and when the file
+	/// is closed, the temporary file is synced to disk and renamed to the file path. Readers (and a restarted process after a crash) see 
+	/// either the previous file or the completely written file. If the object is destroyed without calling close(), or if close() fails,
+	/// the temporary file is removed, and the file path is not changed.
+	/// @param filepath the file path
+	/// @param overwrite_existing if false, the file will not be overwritten if it already exists, and the function (or close) will return status::already_exists
+	/// @param unbuffered if true, open the file in unbuffered mode, if supported by the file system (see is_unbuffered)
+	/// @return 
+	/// - status::ok if the file was opened successfully
+	/// - status::cant_write if the temporary file could not be created
+	/// - status::already_exists if the file already exists and overwrite_existing is false
+	status open_write_atomic(const std::string & filepath, bool overwrite_existing = false, bool unbuffered = false);
 
-	/// @brief Close the file
+	/// @brief Reserve disk space for the file, so that a large file which is written is not fragmented. The size of the file is not changed. 
+	/// @param size the number of bytes to reserve
+	/// @return 
+	/// - status::ok if the space was reserved, or if the file system does not support preallocation
+	/// - status::cant_write if the space could not be reserved
+	status preallocate(const u64 size);
+
+	/// @brief Close the file. If the file was opened with open_write_atomic, the file is synced to disk and renamed to its file path.
+	/// @return 
+	/// - status::ok if the file was closed
+	/// - status::cant_write if an atomic write could not be synced or renamed
+	/// - status::already_exists if an atomic write should not overwrite an existing file, and the file exists
 	status close();
 
 	/// @brief Check if the file is open
 	bool is_open() const;
 
+	/// @brief Check if the file is in unbuffered mode, which bypasses the OS page cache
+	bool is_unbuffered() const { return this->unbuffered; }
+
 	/// @brief Get the size of the file
 	u64 size() const { return this->file_size; };
 
@@ -131,6 +228,125 @@ public:
 	/// - status::ok if the data was written successfully
 	/// - status::cant_write if the data could not be written
 	status write(const u8 * src, const u64 size);
+
+	/// @brief Write a number of memory spans to the file, in order, using as few calls as possible (writev on Linux)
+	/// @param spans the spans to write
+	/// @param count the number of spans
+	/// @return 
+	/// - status::ok if the data was written successfully
+	/// - status::cant_write if the data could not be written
+	status write_gather(const write_span * spans, const size_t count);
+
+	/// @brief Read data from a specific position in the file
+	/// @details Positional reads do not depend on a shared file position, so multiple threads can read disjoint regions 
+	/// of the same file at the same time. Do not mix with the sequential read(), since the file position is not defined 
+	/// after the call on all platforms.
+	/// @param offset the position in the file to read from
+	/// @param dest the destination buffer
+	/// @param size the number of bytes to read
+	/// @return 
+	/// - status::ok if the data was read successfully
+	/// - status::cant_read if the data could not be read, or the file ended before size bytes were read
+	status read_at(const u64 offset, u8 * dest, const u64 size);
+
+	/// @brief Write data to a specific position in the file
+	/// @details Positional writes do not depend on a shared file position, so multiple threads can write disjoint regions 
+	/// of the same file at the same time. Do not mix with the sequential write(), since the file position is not defined 
+	/// after the call on all platforms.
+	/// @param offset the position in the file to write to
+	/// @param src the source buffer
+	/// @param size the number of bytes to write
+	/// @return 
+	/// - status::ok if the data was written successfully
+	/// - status::cant_write if the data could not be written
+	status write_at(const u64 offset, const u8 * src, const u64 size);
+};
+
+/// @brief A batch of positional reads and writes on open files, which are submitted together, and complete asynchronously.
+/// @details start() submits the queued operations without waiting for them, and wait() collects the completions, so the caller 
+/// can do other work while the batch is in flight. submit() does both. On Linux, the operations are submitted through io_uring, 
+/// if the kernel headers support it (detected at compile time, define CTLE_DISABLE_IO_URING to disable) and the running kernel 
+/// supports it (checked when the batch is created), so that a whole batch of reads and writes needs only a few system calls. 
+/// Otherwise, the operations are run one at a time with _file_object::read_at and _file_object::write_at, on a worker thread 
+/// owned by the batch. The files and memory of the queued operations must stay valid until wait() or submit() returns.
+class file_io_batch
+{
+public:
+	/// @brief Create a batch
+	/// @param queue_depth the max number of operations which are in flight at the same time
+	/// @param use_io_uring if false, io_uring is not used, even if it is available
+	file_io_batch( size_t queue_depth = 64, bool use_io_uring = true );
+	~file_io_batch();
+
+	file_io_batch( const file_io_batch & ) = delete;
+	file_io_batch &operator=( const file_io_batch & ) = delete;
+
+	/// @brief Queue a read from a specific position in a file, which is opened for reading
+	/// @param file the file to read from
+	/// @param offset the position in the file to read from
+	/// @param dest the destination buffer
+	/// @param size the number of bytes to read
+	/// @return the index of the operation in the batch
+	size_t queue_read( _file_object &file, u64 offset, u8 *dest, u64 size );
+
+	/// @brief Queue a write to a specific position in a file, which is opened for writing
+	/// @param file the file to write to
+	/// @param offset the position in the file to write to
+	/// @param src the source buffer
+	/// @param size the number of bytes to write
+	/// @return the index of the operation in the batch
+	size_t queue_write( _file_object &file, u64 offset, const u8 *src, u64 size );
+
+	/// @brief Start all queued operations, without waiting for them to complete. Call wait() to collect the completions.
+	/// @return status::ok if the batch was started, status::invalid_param if the batch is already started
+	status start();
+
+	/// @brief Wait for all operations of a started batch to complete. 
+	/// @details The status of each operation can be read with get_status(), until the next operation is queued, which starts a new batch.
+	/// (Queueing an operation while a batch is in flight first waits for the batch.)
+	/// @return status::ok if all operations succeeded, else the status of the first failed operation
+	status wait();
+
+	/// @brief Start all queued operations, and wait for all of them to complete. Same as start() followed by wait().
+	/// @return status::ok if all operations succeeded, else the status of the first failed operation
+	status submit();
+
+	/// @brief Get the status of an operation in the batch, after wait() or submit() has returned. 
+	/// @return status::ok if the operation succeeded, status::cant_read or status::cant_write if it failed (e.g. if the file ended before 
+	/// all bytes were read), or status::not_ready if the operation has not been submitted
+	status get_status( size_t operation_index ) const { return this->operations[operation_index].result; }
+
+	/// @brief Get the number of operations in the batch
+	size_t get_operation_count() const { return this->operations.size(); }
+
+	/// @brief Returns true if the operations are submitted through io_uring
+	bool is_using_io_uring() const { return this->ring != nullptr; }
+
+private:
+	struct operation
+	{
+		_file_object *file;
+		u64 offset;
+		u8 *data;
+		u64 size;
+		u64 done;
+		bool write;
+		status result;
+	};
+
+	struct io_uring_data;
+
+	std::vector<operation> operations;
+	bool submitted = false;
+	bool in_flight = false;
+	std::unique_ptr<io_uring_data> ring;
+
+	// runs the operations when io_uring is not used. (declared last, so it is stopped before the operations are released)
+	task_worker worker;
+
+	size_t queue_operation( _file_object &file, u64 offset, u8 *data, u64 size, bool write );
+	status run_operation( operation &op );
+	status run_io_uring( bool start_batch, bool wait_for_completion );
 };
 
 }
@@ -138,6 +354,13 @@ public:
 
 #ifdef CTLE_IMPLEMENTATION
 
+#include <thread>
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <chrono>
+#include <algorithm>
+
 #include "log.h"
 #include "_macros.inl"
 
@@ -176,19 +399,175 @@ status read_file(const std::string& filepath, std::vector<uint8_t>& dest)
 	return status::ok;
 }
 
-status write_file( const std::string &filepath, const void *src, size_t src_size, bool overwrite_existing )
+// reads batches of files, until all files are claimed by the worker threads
+static void _read_files_worker( const std::vector<std::string> &filepaths, std::vector<std::vector<uint8_t>> &dest, std::vector<status> &file_status, std::atomic<size_t> &next_file )
+{
+	const size_t batch_size = 64;
+	file_io_batch batch( batch_size );
+	std::vector<_file_object> files( batch_size );
+	std::vector<std::pair<size_t, size_t>> queued; // (operation index, file index)
+
+	for(;;)
+	{
+		const size_t first_file = next_file.fetch_add( batch_size );
+		if( first_file >= filepaths.size() )
+			break;
+		const size_t file_count = std::min( batch_size, filepaths.size() - first_file );
+
+		// open and size the files, and queue the reads
+		queued.clear();
+		for( size_t inx = 0; inx < file_count; ++inx )
+		{
+			const size_t file_index = first_file + inx;
+			file_status[file_index] = files[inx].open_read( filepaths[file_index] );
+			if( file_status[file_index] != status::ok )
+				continue;
+
+			// the worker runs on its own thread, so allocation failures must not escape as exceptions
+			try
+			{
+				dest[file_index].resize( files[inx].size() );
+			}
+			catch( const std::bad_alloc & )
+			{
+				file_status[file_index] = status::cant_allocate;
+				continue;
+			}
+			catch( const std::length_error & )
+			{
+				file_status[file_index] = status::cant_allocate;
+				continue;
+			}
+
+			queued.emplace_back( batch.queue_read( files[inx], 0, dest[file_index].data(), dest[file_index].size() ), file_index );
+		}
+
+		// read all the files of the batch, and close them
+		batch.submit();
+		for( auto &op : queued )
+			file_status[op.second] = batch.get_status( op.first );
+		for( size_t inx = 0; inx < file_count; ++inx )
+			files[inx].close();
+	}
+}
+
+status read_files( const std::vector<std::string> &filepaths, std::vector<std::vector<uint8_t>> &dest, std::vector<status> &file_status, size_t thread_count )
+{
+	dest.clear();
+	dest.resize( filepaths.size() );
+	file_status.assign( filepaths.size(), status::not_ready );
+
+	if( thread_count == 0 )
+		thread_count = std::max( (size_t)std::thread::hardware_concurrency(), (size_t)1 );
+
+	// run the workers, the calling thread is one of the workers
+	std::atomic<size_t> next_file( 0 );
+	std::vector<std::thread> threads;
+	for( size_t inx = 1; inx < thread_count; ++inx )
+		threads.emplace_back( _read_files_worker, std::cref( filepaths ), std::ref( dest ), std::ref( file_status ), std::ref( next_file ) );
+	_read_files_worker( filepaths, dest, file_status, next_file );
+	for( auto &t : threads )
+		t.join();
+
+	for( size_t inx = 0; inx < filepaths.size(); ++inx )
+	{
+		ctValidate( file_status[inx] == status::ok, file_status[inx] ) << "Failed to read file " << filepaths[inx] << ctValidateEnd;
+	}
+	return status::ok;
+}
+
+status read_files( const std::vector<std::string> &filepaths, std::vector<std::vector<uint8_t>> &dest, size_t thread_count )
+{
+	std::vector<status> file_status;
+	return read_files( filepaths, dest, file_status, thread_count );
+}
+
+status write_file( const std::string &filepath, const void *src, size_t src_size, bool overwrite_existing, bool atomic )
 {
 	// src can only be nullptr if src_size is 0
 	if( !src && src_size > 0 )
 		return status::invalid_param;
 	
 	_file_object f;
-	ctStatusCall(f.open_write(filepath,overwrite_existing));
+	if( atomic )
+	{
+		ctStatusCall(f.open_write_atomic(filepath,overwrite_existing));
+	}
+	else
+	{
+		ctStatusCall(f.open_write(filepath,overwrite_existing));
+	}
+	ctStatusCall(f.preallocate(src_size));
 	ctStatusCall(f.write( (u8*)src, src_size));
 	ctStatusCall(f.close());
 	return status::ok;
 }
 
+status _file_object::open_write_atomic( const std::string &filepath, bool overwrite_existing, bool unbuffered )
+{
+	if( this->is_open() )
+		this->close();
+
+	// fail early if the file should not be overwritten (the rename in close also fails if the file is created in the meantime)
+	if( !overwrite_existing && file_exists( filepath ) )
+		return status::already_exists;
+
+	// create a new temporary file in the same directory, so it can be renamed to the file path. retry with a new name if the name is taken.
+	static std::atomic<u64> temp_file_counter( 0 );
+	const u64 temp_file_seed = (u64)std::chrono::steady_clock::now().time_since_epoch().count();
+	for( size_t attempt = 0; attempt < 100; ++attempt )
+	{
+		const std::string temp_path = filepath + "." + std::to_string( ( temp_file_seed + temp_file_counter++ ) % 1000000000 ) + ".tmp";
+		const status result = this->open_write( temp_path, false, unbuffered );
+		if( result == status::already_exists )
+			continue;
+		if( result != status::ok )
+			return result;
+
+		this->atomic_temp_path = temp_path;
+		this->atomic_target_path = filepath;
+		this->atomic_overwrite_existing = overwrite_existing;
+		return status::ok;
+	}
+
+	ctLogError << "Failed to create a temporary file for " << filepath << ctLogEnd;
+	return status::cant_write;
+}
+
+status _file_object::close()
+{
+	if( this->atomic_temp_path.empty() )
+	{
+		this->close_file();
+		return status::ok;
+	}
+
+	// an atomic write is synced to disk, and then renamed to the file path
+	status result = status::ok;
+	if( this->is_open() )
+		result = this->sync();
+	if( result != status::ok )
+	{
+		this->discard_atomic_write();
+		return result;
+	}
+	this->close_file();
+	return this->commit_atomic_write();
+}
+
+bool _file_object::is_unbuffered_aligned( const u64 offset, const void *data, const u64 size )
+{
+	return ( ( offset | (u64)(uintptr_t)data | size ) & ( unbuffered_alignment - 1 ) ) == 0;
+}
+
+std::string split_file_segment_path(const std::string& filepath, size_t segment_index)
+{
+	std::string index_str = std::to_string( segment_index );
+	if( index_str.size() < 3 )
+		index_str.insert( 0, 3 - index_str.size(), '0' );
+	return filepath + "." + index_str;
+}
+
 }
 //namespace ctle
 
@@ -238,10 +617,11 @@ _file_object::_file_object()
 
 _file_object::~_file_object()
 {
+	this->discard_atomic_write();
 	this->close();
 }
 
-status _file_object::open_read(const std::string& filepath)
+status _file_object::open_read(const std::string& filepath, bool unbuffered)
 {
 	if (this->is_open())
 		this->close();
@@ -249,12 +629,14 @@ status _file_object::open_read(const std::string& filepath)
 	// convert the utf8 string to wstring fullpath for the API call
 	const auto wpath = utf8string_to_wstringfullpath(filepath);
 
-	this->file_handle = ::CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, nullptr);
+	this->file_handle = ::CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY | ( ( unbuffered ) ? ( FILE_FLAG_NO_BUFFERING ) : ( 0 ) ), nullptr);
 	if (this->file_handle == INVALID_HANDLE_VALUE)
 	{
 		// failed to open the file
 		return status::cant_open;
 	}
+	this->file_access = GENERIC_READ;
+	this->unbuffered = unbuffered;
 
 	// get the size
 	LARGE_INTEGER dfilesize = {};
@@ -268,14 +650,14 @@ status _file_object::open_read(const std::string& filepath)
 	return status::ok;
 }
 
-status _file_object::open_write(const std::string& filepath, bool overwrite_existing)
+status _file_object::open_write(const std::string& filepath, bool overwrite_existing, bool unbuffered)
 {
 	if (this->is_open())
 		this->close();
 
 	// convert the utf8 string to wstring fullpath for the API call
 	const auto wpath = utf8string_to_wstringfullpath(filepath);
-	this->file_handle = (void*)::CreateFileW( wpath.c_str(), GENERIC_WRITE,	FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr, ( overwrite_existing ) ? ( CREATE_ALWAYS ) : ( CREATE_NEW ),	FILE_ATTRIBUTE_NORMAL, nullptr );
+	this->file_handle = (void*)::CreateFileW( wpath.c_str(), GENERIC_WRITE,	FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, nullptr, ( overwrite_existing ) ? ( CREATE_ALWAYS ) : ( CREATE_NEW ),	FILE_ATTRIBUTE_NORMAL | ( ( unbuffered ) ? ( FILE_FLAG_NO_BUFFERING ) : ( 0 ) ), nullptr );
 	if( this->file_handle == INVALID_HANDLE_VALUE )
 	{
 		// file open failed. return reason in error code
@@ -289,21 +671,96 @@ status _file_object::open_write(const std::string& filepath, bool overwrite_exis
 			return status::cant_write;
 		}
 	}
+	this->file_access = GENERIC_WRITE;
+	this->unbuffered = unbuffered;
 
 	return status::ok;
 }
 
-status _file_object::close()
+void _file_object::close_file()
 {
 	if (this->is_open())
 	{
 		::CloseHandle(file_handle);
 		this->file_handle = INVALID_HANDLE_VALUE;
 		this->file_size = 0;
+		this->unbuffered = false;
+	}
+}
+
+status _file_object::sync()
+{
+	// flush the file data to disk
+	if( !::FlushFileBuffers( this->file_handle ) )
+		return status::cant_write;
+	return status::ok;
+}
+
+status _file_object::commit_atomic_write()
+{
+	const auto wtemp_path = utf8string_to_wstringfullpath( this->atomic_temp_path );
+	const auto wtarget_path = utf8string_to_wstringfullpath( this->atomic_target_path );
+
+	// move the file to the file path, and wait for the move to be written to disk. if not overwriting, the move fails if the file path exists.
+	status result = status::ok;
+	const DWORD flags = MOVEFILE_WRITE_THROUGH | ( ( this->atomic_overwrite_existing ) ? ( MOVEFILE_REPLACE_EXISTING ) : ( 0 ) );
+	if( !::MoveFileExW( wtemp_path.c_str(), wtarget_path.c_str(), flags ) )
+	{
+		const DWORD error_code = ::GetLastError();
+		result = ( error_code == ERROR_ALREADY_EXISTS || error_code == ERROR_FILE_EXISTS ) ? status::already_exists : status::cant_write;
+		::DeleteFileW( wtemp_path.c_str() );
 	}
+
+	this->atomic_temp_path.clear();
+	this->atomic_target_path.clear();
+	return result;
+}
+
+void _file_object::discard_atomic_write()
+{
+	if( this->atomic_temp_path.empty() )
+		return;
+	this->close_file();
+	::DeleteFileW( utf8string_to_wstringfullpath( this->atomic_temp_path ).c_str() );
+	this->atomic_temp_path.clear();
+	this->atomic_target_path.clear();
+}
+
+status _file_object::preallocate(const u64 size)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+	if( size == 0 )
+		return status::ok;
+
+	// reserve the clusters without changing the end of the file
+	FILE_ALLOCATION_INFO allocation_info = {};
+	allocation_info.AllocationSize.QuadPart = (LONGLONG)size;
+	if( !::SetFileInformationByHandle( this->file_handle, FileAllocationInfo, &allocation_info, sizeof(allocation_info) ) )
+		return status::cant_write;
 	return status::ok;
 }
 
+bool _file_object::make_buffered()
+{
+	// reopen the file without FILE_FLAG_NO_BUFFERING, and move the file position over to the new handle
+	LARGE_INTEGER zero = {};
+	LARGE_INTEGER position = {};
+	if( !::SetFilePointerEx( this->file_handle, zero, &position, FILE_CURRENT ) )
+		return false;
+	HANDLE buffered_handle = ::ReOpenFile( this->file_handle, this->file_access, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, 0 );
+	if( buffered_handle == INVALID_HANDLE_VALUE )
+		return false;
+	if( !::SetFilePointerEx( buffered_handle, position, nullptr, FILE_BEGIN ) )
+	{
+		::CloseHandle( buffered_handle );
+		return false;
+	}
+	::CloseHandle( this->file_handle );
+	this->file_handle = buffered_handle;
+	this->unbuffered = false;
+	return true;
+}
+
 bool _file_object::is_open() const
 {
 	return this->file_handle != INVALID_HANDLE_VALUE;
@@ -313,6 +770,10 @@ status _file_object::read(u8* dest, const u64 size)
 {
 	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
 
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( 0, dest, size ) && !this->make_buffered() )
+		return status::cant_read;
+
 	u64 bytes_read = 0;
 	while( bytes_read < size )
 	{
@@ -324,6 +785,10 @@ status _file_object::read(u8* dest, const u64 size)
 		DWORD bytes_that_were_read = 0;
 		if( !::ReadFile( this->file_handle, &dest[bytes_read], bytes_to_read_this_time, &bytes_that_were_read, nullptr ) )
 		{
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( this->unbuffered && ::GetLastError() == ERROR_INVALID_PARAMETER && this->make_buffered() )
+				continue;
+
 			// failed to read from the file
 			return status::cant_read;
 		}
@@ -343,6 +808,10 @@ status _file_object::write(const u8* src, const u64 size)
 {
 	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
 
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( 0, src, size ) && !this->make_buffered() )
+		return status::cant_write;
+
 	// write the file
 	u64 bytes_written = 0;
 	while( bytes_written < size )
@@ -355,6 +824,106 @@ status _file_object::write(const u8* src, const u64 size)
 		DWORD bytes_that_were_written = 0;
 		if( !::WriteFile( this->file_handle, &src[bytes_written], (DWORD)bytes_to_write_this_time, &bytes_that_were_written, nullptr ) )
 		{
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( this->unbuffered && ::GetLastError() == ERROR_INVALID_PARAMETER && this->make_buffered() )
+				continue;
+
+			// failed to write to file
+			return status::cant_write;
+		}
+		ctSanityCheck( bytes_that_were_written != 0 ); // this should not happen with a regular file
+
+		// update number of bytes that were written
+		bytes_written += bytes_that_were_written;
+	}
+
+	return status::ok;
+}
+
+status _file_object::write_gather(const write_span* spans, const size_t count)
+{
+	// there is no buffered gather write on Windows (WriteFileGather requires unbuffered, page aligned writes), so write the spans one by one
+	for( size_t inx = 0; inx < count; ++inx )
+	{
+		ctStatusCall(this->write((const u8*)spans[inx].data, spans[inx].size));
+	}
+	return status::ok;
+}
+
+status _file_object::read_at(const u64 offset, u8* dest, const u64 size)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( offset, dest, size ) && !this->make_buffered() )
+		return status::cant_read;
+
+	u64 bytes_read = 0;
+	while( bytes_read < size )
+	{
+		// check how much to read and cap each read at UINT_MAX
+		const u64 bytes_left = size - bytes_read;
+		const DWORD bytes_to_read_this_time = (bytes_left < UINT_MAX) ? ((DWORD)bytes_left) : (UINT_MAX);
+
+		// set up the position to read from
+		const u64 read_offset = offset + bytes_read;
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)(read_offset & 0xffffffff);
+		overlapped.OffsetHigh = (DWORD)(read_offset >> 32);
+
+		// read in bytes into the memory allocation
+		DWORD bytes_that_were_read = 0;
+		if( !::ReadFile( this->file_handle, &dest[bytes_read], bytes_to_read_this_time, &bytes_that_were_read, &overlapped ) )
+		{
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( this->unbuffered && ::GetLastError() == ERROR_INVALID_PARAMETER && this->make_buffered() )
+				continue;
+
+			// failed to read from the file
+			return status::cant_read;
+		}
+		if( bytes_that_were_read == 0 )
+		{
+			// the file ended before all bytes were read
+			return status::cant_read; 
+		}
+
+		// update number of bytes that were read
+		bytes_read += bytes_that_were_read;
+	}
+
+	return status::ok;
+}
+
+status _file_object::write_at(const u64 offset, const u8* src, const u64 size)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( offset, src, size ) && !this->make_buffered() )
+		return status::cant_write;
+
+	u64 bytes_written = 0;
+	while( bytes_written < size )
+	{
+		// check how much to write, capped at UINT_MAX
+		const u64 bytes_left = size - bytes_written;
+		const DWORD bytes_to_write_this_time = (bytes_left < UINT_MAX) ? ((DWORD)bytes_left) : (UINT_MAX);
+
+		// set up the position to write to
+		const u64 write_offset = offset + bytes_written;
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)(write_offset & 0xffffffff);
+		overlapped.OffsetHigh = (DWORD)(write_offset >> 32);
+
+		// write the bytes to file
+		DWORD bytes_that_were_written = 0;
+		if( !::WriteFile( this->file_handle, &src[bytes_written], bytes_to_write_this_time, &bytes_that_were_written, &overlapped ) )
+		{
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( this->unbuffered && ::GetLastError() == ERROR_INVALID_PARAMETER && this->make_buffered() )
+				continue;
+
 			// failed to write to file
 			return status::cant_write;
 		}
@@ -374,6 +943,7 @@ status _file_object::write(const u8* src, const u64 size)
 
 #define _ADD_CTLE_HEADERS_LINUX_STD
 #include "os.inl"
+#include <sys/syscall.h>
 
 namespace ctle
 {
@@ -398,85 +968,418 @@ _file_object::_file_object()
 
 _file_object::~_file_object()
 {
+	this->discard_atomic_write();
 	this->close();
 }
 
-status _file_object::open_read(const std::string& filepath)
+// open a file, retry if interrupted by a signal. if unbuffered is requested but not supported by the file system, the file is left buffered.
+// (O_DIRECT is set with fcntl after the file is opened, and not passed to open, since a file system which rejects O_DIRECT fails the 
+// open with EINVAL after it has created the file, so that a retry with O_EXCL would fail)
+static int _open_file_descriptor( const std::string &filepath, int flags, bool &unbuffered )
+{
+	int fd = -1;
+	do
+	{
+		fd = ::open( filepath.c_str(), flags, 0666 );
+	}
+	while( fd == -1 && errno == EINTR );
+
+	if( fd != -1 && unbuffered )
+	{
+		const int file_flags = ::fcntl( fd, F_GETFL );
+		if( file_flags == -1 || ::fcntl( fd, F_SETFL, file_flags | O_DIRECT ) == -1 )
+			unbuffered = false;
+	}
+	return fd;
+}
+
+status _file_object::open_read(const std::string& filepath, bool unbuffered)
 {
 	if (this->is_open())
 		this->close();
 
-	// open the file at the end, so we can tell() the size of the file
-	this->file_handle = new std::ifstream(filepath.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
-	if( !this->file_handle || !((std::ifstream*)this->file_handle)->is_open() )
+	// open the file
+	this->file_descriptor = _open_file_descriptor( filepath, O_RDONLY | O_CLOEXEC, unbuffered );
+	if( this->file_descriptor == -1 )
 	{
-		this->close();
+		// failed to open the file
 		return status::cant_open;
 	}
 
-	// get the size of the file, and move back to the beginning
-	this->file_size = ((std::ifstream*)this->file_handle)->tellg();
-	((std::ifstream*)this->file_handle)->seekg( 0, std::ios::beg );
+	// get the size
+	struct stat file_stat = {};
+	if( ::fstat( this->file_descriptor, &file_stat ) != 0 )
+	{
+		// failed to get the size
+		this->close();
+		return status::corrupted;
+	}
+	this->file_size = (u64)file_stat.st_size;
+	this->unbuffered = unbuffered;
 
 	return status::ok;
 }
 
-status _file_object::open_write(const std::string& filepath, bool overwrite_existing)
+status _file_object::open_write(const std::string& filepath, bool overwrite_existing, bool unbuffered)
 {
 	if (this->is_open())
 		this->close();
 
-	// if we can't overwrite an existing file, fail if the file exists
-	if( !overwrite_existing && file_exists( filepath ) )
-		return status::already_exists;
+	// create the file. if we can't overwrite an existing file, let the open call fail if the file exists
+	const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | ( ( overwrite_existing ) ? ( O_TRUNC ) : ( O_EXCL ) );
+	this->file_descriptor = _open_file_descriptor( filepath, flags, unbuffered );
+	if( this->file_descriptor == -1 )
+	{
+		// file open failed. return reason in error code
+		if( errno == EEXIST )
+		{
+			return status::already_exists;
+		}
+		else
+		{
+			return status::cant_write;
+		}
+	}
+	this->unbuffered = unbuffered;
+
+	return status::ok;
+}
 
-	// create the file
-	this->file_handle = new std::ofstream( filepath.c_str(), std::ios::out | std::ios::binary );
-	if( !this->file_handle || !((std::ofstream*)this->file_handle)->is_open() )
+void _file_object::close_file()
+{
+	if (this->is_open())
 	{
-		this->close();
-		return status::cant_write;
+		// note: close is not retried on EINTR, since the descriptor is released regardless on Linux
+		::close( this->file_descriptor );
+		this->file_descriptor = -1;
+		this->file_size = 0;
+		this->unbuffered = false;
 	}
+}
 
+status _file_object::sync()
+{
+	// flush the file data to disk, retry if interrupted by a signal
+	while( ::fsync( this->file_descriptor ) != 0 )
+	{
+		if( errno == EINTR )
+			continue;
+		return status::cant_write;
+	}
 	return status::ok;
 }
 
-status _file_object::close()
+// renames a file, but fails with EEXIST if the new path exists, using renameat2 with RENAME_NOREPLACE. fails with ENOSYS if the 
+// build has no renameat2 syscall, and the kernel fails with ENOSYS or EINVAL if it or the file system does not support it.
+static int _rename_noreplace( const char *old_path, const char *new_path )
 {
-	if (this->file_handle)
+#if defined(SYS_renameat2)
+	const unsigned int rename_noreplace = 1; // RENAME_NOREPLACE
+	return (int)::syscall( SYS_renameat2, AT_FDCWD, old_path, AT_FDCWD, new_path, rename_noreplace );
+#else
+	(void)old_path;
+	(void)new_path;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+status _file_object::commit_atomic_write()
+{
+	status result = status::ok;
+	bool temp_file_moved = false;
+	if( this->atomic_overwrite_existing )
+	{
+		// rename replaces an existing file atomically
+		if( ::rename( this->atomic_temp_path.c_str(), this->atomic_target_path.c_str() ) != 0 )
+			result = status::cant_write;
+		else
+			temp_file_moved = true;
+	}
+	else if( _rename_noreplace( this->atomic_temp_path.c_str(), this->atomic_target_path.c_str() ) == 0 )
+	{
+		// renamed without replacing an existing file
+		temp_file_moved = true;
+	}
+	else if( errno != ENOSYS && errno != EINVAL )
 	{
-		delete ((std::ofstream*)this->file_handle);
-		this->file_handle = nullptr;
+		result = ( errno == EEXIST ) ? status::already_exists : status::cant_write;
+	}
+	else
+	{
+		// renameat2 is not supported, fall back to link, which also fails if the file path exists, so an existing file is 
+		// never replaced. the temp file is removed after linking.
+		if( ::link( this->atomic_temp_path.c_str(), this->atomic_target_path.c_str() ) != 0 )
+			result = ( errno == EEXIST ) ? status::already_exists : status::cant_write;
+	}
+	if( !temp_file_moved )
+		::unlink( this->atomic_temp_path.c_str() );
+
+	// sync the directory, so the new directory entry is also on disk
+	if( result == status::ok )
+	{
+		const size_t separator = this->atomic_target_path.find_last_of( '/' );
+		const std::string directory = ( separator == std::string::npos ) ? std::string( "." ) : ( ( separator == 0 ) ? std::string( "/" ) : this->atomic_target_path.substr( 0, separator ) );
+		const int directory_descriptor = ::open( directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+		if( directory_descriptor != -1 )
+		{
+			::fsync( directory_descriptor );
+			::close( directory_descriptor );
+		}
+	}
+
+	this->atomic_temp_path.clear();
+	this->atomic_target_path.clear();
+	return result;
+}
+
+void _file_object::discard_atomic_write()
+{
+	if( this->atomic_temp_path.empty() )
+		return;
+	this->close_file();
+	::unlink( this->atomic_temp_path.c_str() );
+	this->atomic_temp_path.clear();
+	this->atomic_target_path.clear();
+}
+
+status _file_object::preallocate(const u64 size)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+	if( size == 0 )
+		return status::ok;
+
+	// reserve the blocks without changing the file size. preallocation is only a hint, so it is skipped if not supported by the file system
+	while( ::fallocate( this->file_descriptor, FALLOC_FL_KEEP_SIZE, 0, (off_t)size ) != 0 )
+	{
+		if( errno == EINTR )
+			continue;
+		if( errno == EOPNOTSUPP || errno == ENOSYS )
+			return status::ok;
+		return status::cant_write;
 	}
 	return status::ok;
 }
 
+bool _file_object::make_buffered()
+{
+	// clear the O_DIRECT flag of the open file
+	const int flags = ::fcntl( this->file_descriptor, F_GETFL );
+	if( flags == -1 || ::fcntl( this->file_descriptor, F_SETFL, flags & ~O_DIRECT ) == -1 )
+		return false;
+	this->unbuffered = false;
+	return true;
+}
+
 bool _file_object::is_open() const
 {
-	return this->file_handle && ((std::ofstream*)this->file_handle)->is_open();
+	return this->file_descriptor != -1;
 }
 
 status _file_object::read(u8* dest, const u64 size)
 {
-	ctValidate(this->file_handle, status::not_ready) << "The file stream is not open" << ctValidateEnd;
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
 
-	// read the data to the dest
-	((std::ifstream*)this->file_handle)->read((char*)dest, size);
-	if( ((std::ifstream*)this->file_handle)->fail() )
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( 0, dest, size ) && !this->make_buffered() )
 		return status::cant_read;
 
+	u64 bytes_read = 0;
+	while( bytes_read < size )
+	{
+		// read in bytes into the memory allocation, the call may return fewer bytes than requested
+		const ssize_t bytes_that_were_read = ::read( this->file_descriptor, &dest[bytes_read], (size_t)(size - bytes_read) );
+		if( bytes_that_were_read < 0 )
+		{
+			// retry if interrupted by a signal, else fail
+			if( errno == EINTR )
+				continue;
+
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( errno == EINVAL && this->unbuffered && this->make_buffered() )
+				continue;
+			return status::cant_read;
+		}
+		if( bytes_that_were_read == 0 )
+		{
+			// the file ended before all bytes were read
+			return status::cant_read; 
+		}
+
+		// update number of bytes that were read
+		bytes_read += (u64)bytes_that_were_read;
+	}
+
 	return status::ok;
 }
 
 status _file_object::write(const u8* src, const u64 size)
 {
-	ctValidate(this->file_handle, status::not_ready) << "The file stream is not open" << ctValidateEnd;
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
 
-	// read the data to the dest
-	((std::ofstream*)this->file_handle)->write((const char*)src, size);
-	if( ((std::ofstream*)this->file_handle)->fail() )
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( 0, src, size ) && !this->make_buffered() )
+		return status::cant_write;
+
+	u64 bytes_written = 0;
+	while( bytes_written < size )
+	{
+		// write the bytes to file, the call may write fewer bytes than requested
+		const ssize_t bytes_that_were_written = ::write( this->file_descriptor, &src[bytes_written], (size_t)(size - bytes_written) );
+		if( bytes_that_were_written < 0 )
+		{
+			// retry if interrupted by a signal, else fail
+			if( errno == EINTR )
+				continue;
+
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( errno == EINVAL && this->unbuffered && this->make_buffered() )
+				continue;
+			return status::cant_write;
+		}
+		ctSanityCheck( bytes_that_were_written != 0 ); // this should not happen with a regular file
+
+		// update number of bytes that were written
+		bytes_written += (u64)bytes_that_were_written;
+	}
+
+	return status::ok;
+}
+
+status _file_object::write_gather(const write_span* spans, const size_t count)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+
+	// an unaligned span can't be written unbuffered, so switch the file to buffered mode
+	if( this->unbuffered )
+	{
+		for( size_t inx = 0; inx < count; ++inx )
+		{
+			if( !is_unbuffered_aligned( 0, spans[inx].data, spans[inx].size ) )
+			{
+				if( !this->make_buffered() )
+					return status::cant_write;
+				break;
+			}
+		}
+	}
+
+	// the spans are written in batches of io vectors (the number of vectors per call is limited by the OS)
+	const size_t max_batch_count = 64;
+	iovec batch[max_batch_count];
+
+	size_t span_index = 0;
+	size_t span_offset = 0;
+	while( span_index < count )
+	{
+		// set up the batch, starting at the first byte which is not written yet
+		size_t batch_count = 0;
+		size_t batch_size = 0;
+		for( size_t inx = span_index; inx < count && batch_count < max_batch_count; ++inx )
+		{
+			const size_t offset = ( inx == span_index ) ? span_offset : 0;
+			batch[batch_count].iov_base = (void*)&((const u8*)spans[inx].data)[offset];
+			batch[batch_count].iov_len = spans[inx].size - offset;
+			batch_size += batch[batch_count].iov_len;
+			++batch_count;
+		}
+
+		// write the batch, the call may write fewer bytes than requested
+		const ssize_t bytes_that_were_written = ::writev( this->file_descriptor, batch, (int)batch_count );
+		if( bytes_that_were_written < 0 )
+		{
+			// retry if interrupted by a signal, else fail
+			if( errno == EINTR )
+				continue;
+
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( errno == EINVAL && this->unbuffered && this->make_buffered() )
+				continue;
+			return status::cant_write;
+		}
+		ctSanityCheck( bytes_that_were_written != 0 || batch_size == 0 ); // this should not happen with a regular file
+
+		// step past the spans which were fully written, and into the span which was partially written
+		size_t bytes_left = (size_t)bytes_that_were_written;
+		while( span_index < count && bytes_left >= spans[span_index].size - span_offset )
+		{
+			bytes_left -= spans[span_index].size - span_offset;
+			span_offset = 0;
+			++span_index;
+		}
+		span_offset += bytes_left;
+	}
+
+	return status::ok;
+}
+
+status _file_object::read_at(const u64 offset, u8* dest, const u64 size)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( offset, dest, size ) && !this->make_buffered() )
 		return status::cant_read;
 
+	u64 bytes_read = 0;
+	while( bytes_read < size )
+	{
+		// read in bytes from the position into the memory allocation, the call may return fewer bytes than requested
+		const ssize_t bytes_that_were_read = ::pread( this->file_descriptor, &dest[bytes_read], (size_t)(size - bytes_read), (off_t)(offset + bytes_read) );
+		if( bytes_that_were_read < 0 )
+		{
+			// retry if interrupted by a signal, else fail
+			if( errno == EINTR )
+				continue;
+
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( errno == EINVAL && this->unbuffered && this->make_buffered() )
+				continue;
+			return status::cant_read;
+		}
+		if( bytes_that_were_read == 0 )
+		{
+			// the file ended before all bytes were read
+			return status::cant_read; 
+		}
+
+		// update number of bytes that were read
+		bytes_read += (u64)bytes_that_were_read;
+	}
+
+	return status::ok;
+}
+
+status _file_object::write_at(const u64 offset, const u8* src, const u64 size)
+{
+	ctValidate(this->is_open(), status::not_ready) << "The file stream is not open" << ctValidateEnd;
+
+	// an unaligned transfer can't be unbuffered, so switch the file to buffered mode
+	if( this->unbuffered && !is_unbuffered_aligned( offset, src, size ) && !this->make_buffered() )
+		return status::cant_write;
+
+	u64 bytes_written = 0;
+	while( bytes_written < size )
+	{
+		// write the bytes to the position in the file, the call may write fewer bytes than requested
+		const ssize_t bytes_that_were_written = ::pwrite( this->file_descriptor, &src[bytes_written], (size_t)(size - bytes_written), (off_t)(offset + bytes_written) );
+		if( bytes_that_were_written < 0 )
+		{
+			// retry if interrupted by a signal, else fail
+			if( errno == EINTR )
+				continue;
+
+			// in unbuffered mode, transfers which are not aligned fail, switch to buffered mode and retry
+			if( errno == EINVAL && this->unbuffered && this->make_buffered() )
+				continue;
+			return status::cant_write;
+		}
+		ctSanityCheck( bytes_that_were_written != 0 ); // this should not happen with a regular file
+
+		// update number of bytes that were written
+		bytes_written += (u64)bytes_that_were_written;
+	}
+
 	return status::ok;
 }
 
@@ -485,6 +1388,348 @@ status _file_object::write(const u8* src, const u64 size)
 
 #endif// defined(_MSC_VER) elif defined(__GNUC__)
 
+// io_uring is used for the file_io_batch if the kernel headers have IORING_OP_READ and IORING_OP_WRITE (Linux 5.6, which also added IORING_FEAT_RW_CUR_POS)
+#if defined(__linux__) && !defined(CTLE_DISABLE_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define _CTLE_FILE_IO_URING
+#endif
+#endif
+#endif
+
+namespace ctle
+{
+
+#ifdef _CTLE_FILE_IO_URING
+
+// the submission and completion rings of an io_uring instance, mapped into memory
+struct file_io_batch::io_uring_data
+{
+	int ring_fd = -1;
+	unsigned entries = 0;
+
+	void *sq_ring = MAP_FAILED;
+	size_t sq_ring_size = 0;
+	void *cq_ring = MAP_FAILED;
+	size_t cq_ring_size = 0;
+	io_uring_sqe *sqes = (io_uring_sqe*)MAP_FAILED;
+	size_t sqes_size = 0;
+
+	unsigned *sq_head = nullptr;
+	unsigned *sq_tail = nullptr;
+	unsigned *sq_mask = nullptr;
+	unsigned *sq_array = nullptr;
+	unsigned *cq_head = nullptr;
+	unsigned *cq_tail = nullptr;
+	unsigned *cq_mask = nullptr;
+	io_uring_cqe *cqes = nullptr;
+
+	// the submission state of the started batch
+	size_t next_operation = 0;
+	std::vector<size_t> resubmit; // operations which were partially transferred, or need to be retried
+	unsigned in_flight = 0;
+
+	~io_uring_data()
+	{
+		if( this->sqes != MAP_FAILED )
+			::munmap( this->sqes, this->sqes_size );
+		if( this->cq_ring != MAP_FAILED && this->cq_ring != this->sq_ring )
+			::munmap( this->cq_ring, this->cq_ring_size );
+		if( this->sq_ring != MAP_FAILED )
+			::munmap( this->sq_ring, this->sq_ring_size );
+		if( this->ring_fd != -1 )
+			::close( this->ring_fd );
+	}
+
+	// set up the ring, returns false if io_uring is not supported by the kernel (or not permitted)
+	bool setup( unsigned queue_depth )
+	{
+		io_uring_params params = {};
+		this->ring_fd = (int)::syscall( __NR_io_uring_setup, queue_depth, &params );
+		if( this->ring_fd < 0 )
+			return false;
+		this->entries = params.sq_entries;
+
+		// map the rings, which may be mapped as a single area
+		this->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		this->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		const bool single_mmap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+		if( single_mmap )
+			this->sq_ring_size = this->cq_ring_size = std::max( this->sq_ring_size, this->cq_ring_size );
+
+		this->sq_ring = ::mmap( nullptr, this->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQ_RING );
+		if( this->sq_ring == MAP_FAILED )
+			return false;
+		this->cq_ring = ( single_mmap ) ? this->sq_ring : ::mmap( nullptr, this->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_CQ_RING );
+		if( this->cq_ring == MAP_FAILED )
+			return false;
+		this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		this->sqes = (io_uring_sqe*)::mmap( nullptr, this->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES );
+		if( this->sqes == MAP_FAILED )
+			return false;
+
+		u8 *sq = (u8*)this->sq_ring;
+		u8 *cq = (u8*)this->cq_ring;
+		this->sq_head = (unsigned*)&sq[params.sq_off.head];
+		this->sq_tail = (unsigned*)&sq[params.sq_off.tail];
+		this->sq_mask = (unsigned*)&sq[params.sq_off.ring_mask];
+		this->sq_array = (unsigned*)&sq[params.sq_off.array];
+		this->cq_head = (unsigned*)&cq[params.cq_off.head];
+		this->cq_tail = (unsigned*)&cq[params.cq_off.tail];
+		this->cq_mask = (unsigned*)&cq[params.cq_off.ring_mask];
+		this->cqes = (io_uring_cqe*)&cq[params.cq_off.cqes];
+		return true;
+	}
+};
+
+#else
+
+struct file_io_batch::io_uring_data
+{
+};
+
+#endif//_CTLE_FILE_IO_URING
+
+file_io_batch::file_io_batch( size_t queue_depth, bool use_io_uring )
+{
+	ctValidate( queue_depth > 0, status::invalid_param ) << "The queue depth of the batch can not be 0" << ctValidateThrow;
+
+#ifdef _CTLE_FILE_IO_URING
+	if( use_io_uring )
+	{
+		// if io_uring can't be set up, fall back to running the operations one at a time
+		this->ring.reset( new io_uring_data() );
+		if( !this->ring->setup( (unsigned)std::min( queue_depth, (size_t)4096 ) ) )
+		{
+			ctLogInfo << "io_uring is not available, file_io_batch falls back to positional reads and writes" << ctLogEnd;
+			this->ring.reset();
+		}
+	}
+#else
+	(void)use_io_uring;
+#endif
+}
+
+file_io_batch::~file_io_batch()
+{
+	// the operations in flight write to the memory of the caller, so they must complete before the batch is gone
+	if( this->in_flight )
+		this->wait();
+}
+
+size_t file_io_batch::queue_read( _file_object &file, u64 offset, u8 *dest, u64 size )
+{
+	return this->queue_operation( file, offset, dest, size, false );
+}
+
+size_t file_io_batch::queue_write( _file_object &file, u64 offset, const u8 *src, u64 size )
+{
+	return this->queue_operation( file, offset, (u8*)src, size, true );
+}
+
+size_t file_io_batch::queue_operation( _file_object &file, u64 offset, u8 *data, u64 size, bool write )
+{
+	// queueing after a submit starts a new batch
+	if( this->in_flight )
+		this->wait();
+	if( this->submitted )
+	{
+		this->operations.clear();
+		this->submitted = false;
+	}
+
+	this->operations.push_back( { &file, offset, data, size, 0, write, status::not_ready } );
+	return this->operations.size() - 1;
+}
+
+status file_io_batch::run_operation( operation &op )
+{
+	op.result = ( op.write ) ? op.file->write_at( op.offset + op.done, &op.data[op.done], op.size - op.done ) : op.file->read_at( op.offset + op.done, &op.data[op.done], op.size - op.done );
+	op.done = op.size;
+	return op.result;
+}
+
+status file_io_batch::start()
+{
+	ctValidate( !this->in_flight, status::invalid_param ) << "The batch is already started, call wait() before starting it again" << ctValidateEnd;
+	this->submitted = true;
+	this->in_flight = true;
+
+	if( this->ring )
+	{
+		ctStatusCall(this->run_io_uring( true, false ));
+	}
+	else
+	{
+		this->worker.submit( [this]() 
+		{
+			for( auto &op : this->operations )
+				this->run_operation( op );
+			return status::ok;
+		} );
+	}
+	return status::ok;
+}
+
+status file_io_batch::wait()
+{
+	if( this->in_flight )
+	{
+		this->in_flight = false;
+		if( this->ring )
+			ctStatusCall(this->run_io_uring( false, true ));
+		ctStatusCall(this->worker.wait());
+	}
+
+	// report the first failed operation
+	for( size_t inx = 0; inx < this->operations.size(); ++inx )
+	{
+		ctValidate( this->operations[inx].result == status::ok, this->operations[inx].result ) << "Operation " << inx << " of the batch failed" << ctValidateEnd;
+	}
+	return status::ok;
+}
+
+status file_io_batch::submit()
+{
+	ctStatusCall(this->start());
+	return this->wait();
+}
+
+#ifdef _CTLE_FILE_IO_URING
+
+// submits the queued operations to the ring, and reaps the completions. if wait_for_completion is set, runs until all operations
+// have completed, else returns when the operations which fit in the ring are submitted
+status file_io_batch::run_io_uring( bool start_batch, bool wait_for_completion )
+{
+	io_uring_data &r = *this->ring;
+
+	// the max number of bytes of a single read or write (the length is 32 bit)
+	const u64 max_transfer_size = 1024 * 1024 * 1024;
+
+	if( start_batch )
+	{
+		r.next_operation = 0;
+		r.resubmit.clear();
+		r.in_flight = 0;
+	}
+
+	while( r.next_operation < this->operations.size() || !r.resubmit.empty() || r.in_flight > 0 )
+	{
+		// fill up the submission queue, the number of operations in flight is capped to the ring size, so the completion queue (which is larger) can't overflow
+		unsigned tail = *r.sq_tail;
+		while( r.in_flight < r.entries && ( !r.resubmit.empty() || r.next_operation < this->operations.size() ) )
+		{
+			size_t op_index = 0;
+			if( !r.resubmit.empty() )
+			{
+				op_index = r.resubmit.back();
+				r.resubmit.pop_back();
+			}
+			else
+			{
+				op_index = r.next_operation++;
+			}
+
+			operation &op = this->operations[op_index];
+			if( !op.file->is_open() )
+			{
+				op.result = status::not_ready;
+				continue;
+			}
+
+			const unsigned sqe_index = tail & *r.sq_mask;
+			io_uring_sqe &sqe = r.sqes[sqe_index];
+			memset( &sqe, 0, sizeof(sqe) );
+			sqe.opcode = (u8)( ( op.write ) ? IORING_OP_WRITE : IORING_OP_READ );
+			sqe.fd = op.file->file_descriptor;
+			sqe.off = op.offset + op.done;
+			sqe.addr = (u64)(uintptr_t)&op.data[op.done];
+			sqe.len = (u32)std::min( op.size - op.done, max_transfer_size );
+			sqe.user_data = op_index;
+			r.sq_array[sqe_index] = sqe_index;
+			++tail;
+			++r.in_flight;
+		}
+		__atomic_store_n( r.sq_tail, tail, __ATOMIC_RELEASE );
+		if( r.in_flight == 0 )
+			break;
+
+		// submit the new entries (and any entries which were not consumed because of a signal), and if waiting, wait for at least one completion
+		const unsigned to_submit = tail - __atomic_load_n( r.sq_head, __ATOMIC_ACQUIRE );
+		const unsigned min_complete = ( wait_for_completion ) ? 1 : 0;
+		const long ret = ::syscall( __NR_io_uring_enter, r.ring_fd, to_submit, min_complete, ( wait_for_completion ) ? IORING_ENTER_GETEVENTS : 0, nullptr, 0 );
+		if( ret < 0 && errno != EINTR )
+		{
+			// the ring is not usable, close it (which cancels the operations in flight) and fall back to positional reads and writes
+			const int error_code = errno;
+			this->ring.reset();
+			ctLogError << "io_uring_enter failed with errno " << error_code << ", falling back to positional reads and writes" << ctLogEnd;
+			for( auto &op : this->operations )
+			{
+				if( op.result == status::not_ready )
+					this->run_operation( op );
+			}
+			return status::ok;
+		}
+
+		// reap the completions
+		unsigned head = *r.cq_head;
+		const unsigned cq_tail = __atomic_load_n( r.cq_tail, __ATOMIC_ACQUIRE );
+		while( head != cq_tail )
+		{
+			const io_uring_cqe &cqe = r.cqes[head & *r.cq_mask];
+			operation &op = this->operations[(size_t)cqe.user_data];
+			const int res = cqe.res;
+			++head;
+			--r.in_flight;
+
+			if( res == -EINTR || res == -EAGAIN )
+			{
+				r.resubmit.push_back( (size_t)cqe.user_data );
+			}
+			else if( res == -EINVAL || res == -EOPNOTSUPP )
+			{
+				// the operation is not supported by the kernel, run it directly instead
+				this->run_operation( op );
+			}
+			else if( res < 0 || ( res == 0 && op.done < op.size ) )
+			{
+				// failed, or the file ended before all bytes were read
+				op.result = ( op.write ) ? status::cant_write : status::cant_read;
+			}
+			else
+			{
+				// continue partial transfers where they ended
+				op.done += (u64)res;
+				if( op.done < op.size )
+					r.resubmit.push_back( (size_t)cqe.user_data );
+				else
+					op.result = status::ok;
+			}
+		}
+		__atomic_store_n( r.cq_head, head, __ATOMIC_RELEASE );
+
+		if( !wait_for_completion )
+			break;
+	}
+
+	return status::ok;
+}
+
+#else
+
+status file_io_batch::run_io_uring( bool, bool )
+{
+	return status::not_initialized;
+}
+
+#endif//_CTLE_FILE_IO_URING
+
+}
+//namespace ctle
+
 #include "_undef_macros.inl"
 
 #endif//CTLE_IMPLEMENTATION
@@ -42,21 +42,47 @@ template<typename _Ty> using value_return = status_return<status, _Ty>;;
 
 // from data_source.h
 class file_data_source;
+class mmap_data_source;
+class memory_data_source;
+class split_file_data_source;
 
 // from data_destination.h
 class file_data_destination;
+class memory_data_destination;
+class split_file_data_destination;
 
 // from hasher.h
 class hasher_sha256;
+class hasher_sha256_native;
 class hasher_xxh64;
 class hasher_xxh128;
 template <size_t _Size> class hasher_noop;
 
+// from hasher_tree.h
+template<class _LeafHashTy = hasher_sha256_native> class hasher_tree;
+
+// from tee_data_destination.h
+template<class... _DataDestTys> class tee_data_destination;
+
+// from sockets.h
+class socket_data_source;
+class socket_data_destination;
+
+// from task_worker.h
+class task_worker;
+
+// from transform.h
+class transform_noop;
+class transform_lz;
+class transform_zstd;
+
 // from read_stream.h
-template<class _DataSourceTy, class _HashTy = hasher_noop<64>> class read_stream;
+template<class _DataSourceTy, class _HashTy = hasher_noop<64>, class _TransformTy = transform_noop> class read_stream;
+enum class read_stream_flags : int;
 
 // from write_stream.h
-template<class _DataDestTy, class _HashTy = hasher_noop<64>> class write_stream;
+template<class _DataDestTy, class _HashTy = hasher_noop<64>, class _TransformTy = transform_noop> class write_stream;
+enum class write_stream_flags : int;
 
 // from ntup.h
 template<class _Ty, size_t _Size> class n_tup;
@@ -70,7 +96,9 @@ enum class bitmap_font_flags : int;
 
 // from file_funcs.h
 enum class access_mode : unsigned int;
+struct write_span;
 class _file_object;
+class file_io_batch;
 
 // from digest.h
 template<size_t _Size> struct digest;
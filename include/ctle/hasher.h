@@ -13,6 +13,7 @@
 /// - ctor() to initialize the hasher
 /// - update() to update the hash with a block of bytes
 /// - finish(), to end the hashed stream, and return the final hash
+/// - reset(), to restart the hasher for a new stream, reusing the hasher state
 /// @note The hashers are implemented using external libraries. All declarations exist, but to implement a specific library, include 
 /// the library header before including hasher.h in the implementation source file. (see the example implementation in the 
 /// documentation for ctle.h for more information).
@@ -46,6 +47,35 @@ public:
 	/// @brief Finish the hash generation and return the final hash value.
 	/// @return status::ok if the update was successful, and the final hash value	
 	status_return<status, digest<_Size>> finish() { return digest<_Size>(); }
+
+	/// @brief Reset the hasher to its initial state, so it can be reused for a new stream, without reallocating the hasher state.
+	void reset() {}
+};
+
+// in-object storage for an XXH3 state. the state needs 64 byte alignment, and is aligned within the storage, so the hasher objects 
+// themselves do not need extended alignment (which is not supported by new before C++17). Not copyable, since the offset of the
+// aligned state depends on the address of the object. The storage is only declared if XXH_STATIC_LINKING_ONLY is defined, so 
+// the implementation can verify that the state fits, else the state is allocated with XXH3_createState. Since the define changes 
+// the layout of the hashers, it must be the same in all files which include hasher.h (e.g. set as a compiler define).
+class _xxh3_state
+{
+public:
+	static constexpr size_t size = 576; // sizeof(XXH3_state_t) of xxHash 0.8
+	static constexpr size_t alignment = 64;
+
+	_xxh3_state();
+	~_xxh3_state();
+	_xxh3_state( const _xxh3_state & ) = delete;
+	_xxh3_state &operator=( const _xxh3_state & ) = delete;
+
+	void *get();
+
+private:
+#ifdef XXH_STATIC_LINKING_ONLY
+	uint8_t storage[size + alignment - 1];
+#else
+	void *allocated_state = nullptr;
+#endif//XXH_STATIC_LINKING_ONLY
 };
 
 /// @brief Implementation of a SHA-256 hasher, using picosha2.
@@ -63,17 +93,55 @@ public:
 	/// @copydoc hasher_noop::finish
 	status_return<status, digest<256>> finish();
 
+	/// @copydoc hasher_noop::reset
+	void reset();
+
 private:
 	void *context = nullptr;
 };
 
-/// @brief Implementation of XXH3 XXH64 hasher, using xxHash.
+/// @brief Built-in implementation of a SHA-256 hasher, which does not need an external library. 
+/// @details Full 64 byte blocks are compressed using the SHA extensions of the CPU when available: SHA-NI on x86/x64 (detected at 
+/// runtime using cpuid) and the ARMv8 SHA2 instructions on ARM64 (when enabled in the build, e.g. with -march=armv8-a+crypto, or 
+/// always on MSVC ARM64), else a portable scalar implementation is used. The digest is identical to hasher_sha256.
+class hasher_sha256_native
+{
+public:
+	/// @brief Create the hasher
+	/// @param use_cpu_extensions if false, the scalar implementation is used even if the CPU has SHA extensions
+	hasher_sha256_native( bool use_cpu_extensions = true );
+	~hasher_sha256_native() {}
+	using hash_type = digest<256>;
+
+	/// @copydoc hasher_noop::update
+	status update(const uint8_t* data, size_t size);
+
+	/// @copydoc hasher_noop::finish
+	status_return<status, digest<256>> finish();
+
+	/// @copydoc hasher_noop::reset
+	void reset();
+
+	/// @brief Get the name of the block compression implementation which is used by the hasher: "sha-ni", "armv8" or "scalar"
+	const char *get_implementation() const;
+
+private:
+	using compress_function = void (*)( uint32_t *state, const uint8_t *blocks, size_t block_count );
+
+	uint32_t state[8];
+	uint8_t block[64];
+	size_t block_size = 0;
+	uint64_t total_size = 0;
+	compress_function compress = nullptr;
+};
+
+/// @brief Implementation of XXH3 XXH64 hasher, using xxHash. The XXH3 state is stored in the object, so the hasher does not allocate (see _xxh3_state).
 /// @note To use, include xxHash in the build before hasher.h to implement (see the example implementation in the documentation for ctle.h).
 class hasher_xxh64
 {
 public:
 	hasher_xxh64();
-	~hasher_xxh64();
+	~hasher_xxh64() {}
 	using hash_type = digest<64>;
 
 	/// @copydoc hasher_noop::update
@@ -82,17 +150,20 @@ public:
 	/// @copydoc hasher_noop::finish
 	status_return<status, digest<64>> finish();
 
+	/// @copydoc hasher_noop::reset
+	void reset();
+
 private:
-	void *context = nullptr;
+	_xxh3_state context;
 };
 
-/// @brief Implementation of XXH3 XXH128 hasher, using xxHash.
+/// @brief Implementation of XXH3 XXH128 hasher, using xxHash. The XXH3 state is stored in the object, so the hasher does not allocate (see _xxh3_state).
 /// @note To use, include xxHash in the build before hasher.h to implement (see the example implementation in the documentation for ctle.h).
 class hasher_xxh128
 {
 public:
 	hasher_xxh128();
-	~hasher_xxh128();
+	~hasher_xxh128() {}
 	using hash_type = digest<128>;
 
 	/// @copydoc hasher_noop::update
@@ -101,17 +172,21 @@ public:
 	/// @copydoc hasher_noop::finish
 	status_return<status, digest<128>> finish();
 
+	/// @copydoc hasher_noop::reset
+	void reset();
+
 private:
-	void *context = nullptr;
+	_xxh3_state context;
 };
 
 /// @brief Implementation of XXH3 XXH128 hasher, using xxHash, concatenated into one 256 bit hash. Note that the second part of the hash is generated from an added salt of dcb7be9cd0fcf505, (big endian).
+/// The XXH3 state is stored in the object, so the hasher does not allocate (see _xxh3_state).
 /// @note To use, include xxHash in the build before hasher.h to implement (see the example implementation in the documentation for ctle.h).
 class hasher_2x_xxh128_dcb7be9cd0fcf505 
 {
 public:
 	hasher_2x_xxh128_dcb7be9cd0fcf505();
-	~hasher_2x_xxh128_dcb7be9cd0fcf505();
+	~hasher_2x_xxh128_dcb7be9cd0fcf505() {}
 	using hash_type = digest<256>;
 
 	/// @copydoc hasher_noop::update
@@ -120,16 +195,620 @@ public:
 	/// @copydoc hasher_noop::finish
 	status_return<status, digest<256>> finish();
 
+	/// @copydoc hasher_noop::reset
+	void reset();
+
 private:
-	void *context = nullptr;
+	_xxh3_state context;
 };
 
+// single-shot hashing of a buffer, used by hash_once and hash_batch. the generic version uses the streaming interface of the hasher, 
+// the overloads use single-shot functions which need no hasher state
+template<class _HashTy> inline typename _HashTy::hash_type _hash_single( const _HashTy *, const uint8_t *data, size_t size )
+{
+	_HashTy hasher;
+	hasher.update( data, size );
+	return hasher.finish().value();
+}
+digest<256> _hash_single( const hasher_sha256 *, const uint8_t *data, size_t size );
+digest<256> _hash_single( const hasher_sha256_native *, const uint8_t *data, size_t size );
+digest<64> _hash_single( const hasher_xxh64 *, const uint8_t *data, size_t size );
+digest<128> _hash_single( const hasher_xxh128 *, const uint8_t *data, size_t size );
+digest<256> _hash_single( const hasher_2x_xxh128_dcb7be9cd0fcf505 *, const uint8_t *data, size_t size );
+
+/// @brief Hash a single buffer in one call, and return the digest.
+/// @details The digest is the same as when hashing the buffer with a hasher object, but the XXH3 hashers use the single-shot XXH3 
+/// functions, which are much faster than the streaming interface for short inputs, and the SHA-256 hashers compress the full blocks 
+/// directly from the buffer, and pad the last block on the stack. No status_return is created. Other hashers use a hasher object.
+/// @tparam _HashTy the hasher to use, e.g. hasher_xxh64
+/// @param data the data to hash
+/// @param size the size of the data in bytes
+/// @return the digest of the data
+template<class _HashTy> inline typename _HashTy::hash_type hash_once( const uint8_t *data, size_t size )
+{
+	return _hash_single( (const _HashTy*)nullptr, data, size );
+}
+
+// hashes count independent buffers with SHA-256. on x86 CPUs with AVX2, the buffers are interleaved in the 8 lanes of the AVX2 
+// registers (multi-buffer hashing), unless the CPU has the SHA extensions and use_sha_extensions is set, since a single buffer at a 
+// time with the extensions is faster. else the buffers are hashed one at a time.
+void _sha256_hash_many( const uint8_t *const *data, const size_t *sizes, size_t count, digest<256> *out, bool use_sha_extensions = true );
+
+// batch hashing, used by hash_batch. the generic version hashes the buffers one at a time with _hash_single, the SHA-256 
+// overloads pass the buffers to _sha256_hash_many, in chunks which are gathered on the stack
+template<class _HashTy, class _SpanTy> inline void _hash_batch( const _HashTy *, const _SpanTy *inputs, size_t count, typename _HashTy::hash_type *out )
+{
+	for( size_t inx = 0; inx < count; ++inx )
+		out[inx] = _hash_single( (const _HashTy*)nullptr, (const uint8_t*)inputs[inx].data, inputs[inx].size );
+}
+template<class _SpanTy> inline void _hash_batch_sha256( const _SpanTy *inputs, size_t count, digest<256> *out )
+{
+	const size_t chunk_size = 64;
+	const uint8_t *data[chunk_size];
+	size_t sizes[chunk_size];
+	for( size_t start = 0; start < count; start += chunk_size )
+	{
+		const size_t chunk_count = ( count - start < chunk_size ) ? ( count - start ) : chunk_size;
+		for( size_t inx = 0; inx < chunk_count; ++inx )
+		{
+			data[inx] = (const uint8_t*)inputs[start + inx].data;
+			sizes[inx] = inputs[start + inx].size;
+		}
+		_sha256_hash_many( data, sizes, chunk_count, &out[start] );
+	}
+}
+template<class _SpanTy> inline void _hash_batch( const hasher_sha256 *, const _SpanTy *inputs, size_t count, digest<256> *out ) { _hash_batch_sha256( inputs, count, out ); }
+template<class _SpanTy> inline void _hash_batch( const hasher_sha256_native *, const _SpanTy *inputs, size_t count, digest<256> *out ) { _hash_batch_sha256( inputs, count, out ); }
+
+/// @brief Hash a batch of independent buffers, and return a digest for each buffer. 
+/// @details The digests are the same as when hashing each buffer with a separate hasher object, but no hasher objects are created. 
+/// The SHA-256 hashers interleave the buffers on x86 CPUs which have AVX2 but not the SHA extensions, and hash 8 buffers at the same 
+/// time in the lanes of the AVX2 registers. With the SHA extensions (or without AVX2), they hash one buffer at a time with the fastest 
+/// compression (see hasher_sha256_native). The XXH3 hashers hash one buffer at a time with the single-shot XXH3 functions, which need 
+/// no state allocation, but are not interleaved. Other hashers fall back to one hasher object per buffer.
+/// @tparam _HashTy the hasher to use, e.g. hasher_xxh128
+/// @tparam _SpanTy the span type of the buffers, which has data and size members, e.g. write_span
+/// @param inputs the buffers to hash
+/// @param count the number of buffers
+/// @param out receives the digests of the buffers, must have room for count digests
+/// @return status::ok, or status::invalid_param if inputs or out is nullptr
+template<class _HashTy, class _SpanTy> inline status hash_batch( const _SpanTy *inputs, size_t count, typename _HashTy::hash_type *out )
+{
+	if( count > 0 && ( !inputs || !out ) )
+		return status::invalid_param;
+
+	_hash_batch( (const _HashTy*)nullptr, inputs, count, out );
+	return status::ok;
+}
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #ifdef CTLE_IMPLEMENTATION
 
+#include <string.h>
+#include <algorithm>
+#include <memory>
+
+////////////////////////////////////////
+
+// the SHA extensions are compiled in on compilers which support the intrinsics (on x86 the functions are compiled for the 
+// extensions using target attributes, and selected at runtime)
+#if ( defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86) ) && ( defined(_MSC_VER) || defined(__clang__) || ( defined(__GNUC__) && __GNUC__ >= 5 ) )
+#define _CTLE_SHA256_X86
+#elif ( defined(__aarch64__) && ( defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO) ) ) || defined(_M_ARM64)
+#define _CTLE_SHA256_ARMV8
+#endif
+
+#if defined(_CTLE_SHA256_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define _CTLE_SHA256_X86_TARGET
+#define _CTLE_SHA256_AVX2_TARGET
+#else
+#include <cpuid.h>
+#define _CTLE_SHA256_X86_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#define _CTLE_SHA256_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#include <immintrin.h>
+#elif defined(_CTLE_SHA256_ARMV8)
+#include <arm_neon.h>
+#endif
+
+namespace ctle
+{
+
+static const uint32_t _sha256_round_constants[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t _sha256_rotr( uint32_t value, int bits ) { return ( value >> bits ) | ( value << ( 32 - bits ) ); }
+
+// portable implementation of the block compression
+static void _sha256_compress_scalar( uint32_t *state, const uint8_t *blocks, size_t block_count )
+{
+	for( ; block_count > 0; --block_count, blocks += 64 )
+	{
+		// expand the message schedule, the words are big endian
+		uint32_t w[64];
+		for( size_t i = 0; i < 16; ++i )
+			w[i] = ( uint32_t( blocks[i*4] ) << 24 ) | ( uint32_t( blocks[i*4+1] ) << 16 ) | ( uint32_t( blocks[i*4+2] ) << 8 ) | uint32_t( blocks[i*4+3] );
+		for( size_t i = 16; i < 64; ++i )
+		{
+			const uint32_t s0 = _sha256_rotr( w[i-15], 7 ) ^ _sha256_rotr( w[i-15], 18 ) ^ ( w[i-15] >> 3 );
+			const uint32_t s1 = _sha256_rotr( w[i-2], 17 ) ^ _sha256_rotr( w[i-2], 19 ) ^ ( w[i-2] >> 10 );
+			w[i] = w[i-16] + s0 + w[i-7] + s1;
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+		for( size_t i = 0; i < 64; ++i )
+		{
+			const uint32_t s1 = _sha256_rotr( e, 6 ) ^ _sha256_rotr( e, 11 ) ^ _sha256_rotr( e, 25 );
+			const uint32_t ch = ( e & f ) ^ ( ~e & g );
+			const uint32_t t1 = h + s1 + ch + _sha256_round_constants[i] + w[i];
+			const uint32_t s0 = _sha256_rotr( a, 2 ) ^ _sha256_rotr( a, 13 ) ^ _sha256_rotr( a, 22 );
+			const uint32_t maj = ( a & b ) ^ ( a & c ) ^ ( b & c );
+			const uint32_t t2 = s0 + maj;
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+	}
+}
+
+#if defined(_CTLE_SHA256_X86)
+
+// block compression using the x86 SHA-NI instructions. the state is kept in the ABEF/CDGH layout which the instructions use
+_CTLE_SHA256_X86_TARGET static void _sha256_compress_shani( uint32_t *state, const uint8_t *blocks, size_t block_count )
+{
+	const __m128i byte_swap_mask = _mm_set_epi64x( 0x0c0d0e0f08090a0bll, 0x0405060700010203ll );
+
+	__m128i tmp = _mm_loadu_si128( (const __m128i*)&state[0] );
+	__m128i state1 = _mm_loadu_si128( (const __m128i*)&state[4] );
+	tmp = _mm_shuffle_epi32( tmp, 0xB1 ); // CDAB
+	state1 = _mm_shuffle_epi32( state1, 0x1B ); // EFGH
+	__m128i state0 = _mm_alignr_epi8( tmp, state1, 8 ); // ABEF
+	state1 = _mm_blend_epi16( state1, tmp, 0xF0 ); // CDGH
+
+	for( ; block_count > 0; --block_count, blocks += 64 )
+	{
+		const __m128i abef_save = state0;
+		const __m128i cdgh_save = state1;
+
+		__m128i msg[4];
+		for( size_t i = 0; i < 4; ++i )
+			msg[i] = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)&blocks[i*16] ), byte_swap_mask );
+
+		// 4 rounds per step, and the message words of 4 steps ahead are calculated from the current words
+		for( size_t i = 0; i < 16; ++i )
+		{
+			__m128i rounds_msg = _mm_add_epi32( msg[i & 3], _mm_loadu_si128( (const __m128i*)&_sha256_round_constants[i*4] ) );
+			state1 = _mm_sha256rnds2_epu32( state1, state0, rounds_msg );
+			rounds_msg = _mm_shuffle_epi32( rounds_msg, 0x0E );
+			state0 = _mm_sha256rnds2_epu32( state0, state1, rounds_msg );
+
+			if( i < 12 )
+			{
+				const __m128i w = _mm_add_epi32( _mm_sha256msg1_epu32( msg[i & 3], msg[(i + 1) & 3] ), _mm_alignr_epi8( msg[(i + 3) & 3], msg[(i + 2) & 3], 4 ) );
+				msg[i & 3] = _mm_sha256msg2_epu32( w, msg[(i + 3) & 3] );
+			}
+		}
+
+		state0 = _mm_add_epi32( state0, abef_save );
+		state1 = _mm_add_epi32( state1, cdgh_save );
+	}
+
+	tmp = _mm_shuffle_epi32( state0, 0x1B ); // FEBA
+	state1 = _mm_shuffle_epi32( state1, 0xB1 ); // DCHG
+	state0 = _mm_blend_epi16( tmp, state1, 0xF0 ); // DCBA
+	state1 = _mm_alignr_epi8( state1, tmp, 8 ); // HGFE
+	_mm_storeu_si128( (__m128i*)&state[0], state0 );
+	_mm_storeu_si128( (__m128i*)&state[4], state1 );
+}
+
+// check for the SHA, SSSE3 and SSE4.1 extensions
+static bool _sha256_has_cpu_extensions()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int regs[4] = {};
+	__cpuid( regs, 0 );
+	if( regs[0] < 7 )
+		return false;
+	__cpuid( regs, 1 );
+	const bool has_ssse3_sse41 = ( regs[2] & ( 1 << 9 ) ) && ( regs[2] & ( 1 << 19 ) );
+	__cpuidex( regs, 7, 0 );
+	return has_ssse3_sse41 && ( regs[1] & ( 1 << 29 ) );
+#else
+	if( __get_cpuid_max( 0, nullptr ) < 7 )
+		return false;
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	__cpuid( 1, eax, ebx, ecx, edx );
+	const bool has_ssse3_sse41 = ( ecx & ( 1u << 9 ) ) && ( ecx & ( 1u << 19 ) );
+	__cpuid_count( 7, 0, eax, ebx, ecx, edx );
+	return has_ssse3_sse41 && ( ebx & ( 1u << 29 ) );
+#endif
+}
+
+static const char *_sha256_cpu_extensions_name = "sha-ni";
+static void (*const _sha256_compress_cpu_extensions)( uint32_t*, const uint8_t*, size_t ) = &_sha256_compress_shani;
+
+// check for AVX2, and that the OS saves the AVX registers
+static bool _sha256_has_avx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int regs[4] = {};
+	__cpuid( regs, 0 );
+	if( regs[0] < 7 )
+		return false;
+	__cpuid( regs, 1 );
+	if( !( regs[2] & ( 1 << 27 ) ) || ( _xgetbv( 0 ) & 6 ) != 6 )
+		return false;
+	__cpuidex( regs, 7, 0 );
+	return ( regs[1] & ( 1 << 5 ) ) != 0;
+#else
+	if( __get_cpuid_max( 0, nullptr ) < 7 )
+		return false;
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	__cpuid( 1, eax, ebx, ecx, edx );
+	if( !( ecx & ( 1u << 27 ) ) )
+		return false;
+	unsigned int xcr0_low = 0, xcr0_high = 0;
+	__asm__( "xgetbv" : "=a"( xcr0_low ), "=d"( xcr0_high ) : "c"( 0 ) );
+	if( ( xcr0_low & 6 ) != 6 )
+		return false;
+	__cpuid_count( 7, 0, eax, ebx, ecx, edx );
+	return ( ebx & ( 1u << 5 ) ) != 0;
+#endif
+}
+
+_CTLE_SHA256_AVX2_TARGET static inline __m256i _sha256_rotr_avx2( __m256i value, int bits ) 
+{ 
+	return _mm256_or_si256( _mm256_srli_epi32( value, bits ), _mm256_slli_epi32( value, 32 - bits ) ); 
+}
+
+// compresses one block in each of 8 independent states, using the 8 lanes of the AVX2 registers. the states are stored 
+// word by word, so state[w][lane] is word w of the state in the lane
+_CTLE_SHA256_AVX2_TARGET static void _sha256_compress_avx2_x8( uint32_t (*state)[8], const uint8_t *const *blocks )
+{
+	const __m256i byte_swap_mask = _mm256_set_epi64x( 0x0c0d0e0f08090a0bll, 0x0405060700010203ll, 0x0c0d0e0f08090a0bll, 0x0405060700010203ll );
+
+	// load the message words of the lanes, word by word
+	__m256i w[16];
+	for( size_t i = 0; i < 16; ++i )
+	{
+		uint32_t words[8];
+		for( size_t lane = 0; lane < 8; ++lane )
+			memcpy( &words[lane], &blocks[lane][i*4], sizeof(uint32_t) );
+		w[i] = _mm256_shuffle_epi8( _mm256_loadu_si256( (const __m256i*)words ), byte_swap_mask );
+	}
+
+	__m256i a = _mm256_loadu_si256( (const __m256i*)state[0] );
+	__m256i b = _mm256_loadu_si256( (const __m256i*)state[1] );
+	__m256i c = _mm256_loadu_si256( (const __m256i*)state[2] );
+	__m256i d = _mm256_loadu_si256( (const __m256i*)state[3] );
+	__m256i e = _mm256_loadu_si256( (const __m256i*)state[4] );
+	__m256i f = _mm256_loadu_si256( (const __m256i*)state[5] );
+	__m256i g = _mm256_loadu_si256( (const __m256i*)state[6] );
+	__m256i h = _mm256_loadu_si256( (const __m256i*)state[7] );
+
+	for( size_t i = 0; i < 64; ++i )
+	{
+		// extend the message in place, the last 16 words are kept
+		if( i >= 16 )
+		{
+			const __m256i w15 = w[(i-15) & 15];
+			const __m256i w2 = w[(i-2) & 15];
+			const __m256i s0 = _mm256_xor_si256( _mm256_xor_si256( _sha256_rotr_avx2( w15, 7 ), _sha256_rotr_avx2( w15, 18 ) ), _mm256_srli_epi32( w15, 3 ) );
+			const __m256i s1 = _mm256_xor_si256( _mm256_xor_si256( _sha256_rotr_avx2( w2, 17 ), _sha256_rotr_avx2( w2, 19 ) ), _mm256_srli_epi32( w2, 10 ) );
+			w[i & 15] = _mm256_add_epi32( _mm256_add_epi32( w[i & 15], s0 ), _mm256_add_epi32( w[(i-7) & 15], s1 ) );
+		}
+
+		const __m256i s1 = _mm256_xor_si256( _mm256_xor_si256( _sha256_rotr_avx2( e, 6 ), _sha256_rotr_avx2( e, 11 ) ), _sha256_rotr_avx2( e, 25 ) );
+		const __m256i ch = _mm256_xor_si256( _mm256_and_si256( e, f ), _mm256_andnot_si256( e, g ) );
+		const __m256i t1 = _mm256_add_epi32( _mm256_add_epi32( _mm256_add_epi32( h, s1 ), _mm256_add_epi32( ch, w[i & 15] ) ), _mm256_set1_epi32( (int)_sha256_round_constants[i] ) );
+		const __m256i s0 = _mm256_xor_si256( _mm256_xor_si256( _sha256_rotr_avx2( a, 2 ), _sha256_rotr_avx2( a, 13 ) ), _sha256_rotr_avx2( a, 22 ) );
+		const __m256i maj = _mm256_or_si256( _mm256_and_si256( a, b ), _mm256_and_si256( c, _mm256_or_si256( a, b ) ) );
+		h = g;
+		g = f;
+		f = e;
+		e = _mm256_add_epi32( d, t1 );
+		d = c;
+		c = b;
+		b = a;
+		a = _mm256_add_epi32( t1, _mm256_add_epi32( s0, maj ) );
+	}
+
+	_mm256_storeu_si256( (__m256i*)state[0], _mm256_add_epi32( a, _mm256_loadu_si256( (const __m256i*)state[0] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[1], _mm256_add_epi32( b, _mm256_loadu_si256( (const __m256i*)state[1] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[2], _mm256_add_epi32( c, _mm256_loadu_si256( (const __m256i*)state[2] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[3], _mm256_add_epi32( d, _mm256_loadu_si256( (const __m256i*)state[3] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[4], _mm256_add_epi32( e, _mm256_loadu_si256( (const __m256i*)state[4] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[5], _mm256_add_epi32( f, _mm256_loadu_si256( (const __m256i*)state[5] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[6], _mm256_add_epi32( g, _mm256_loadu_si256( (const __m256i*)state[6] ) ) );
+	_mm256_storeu_si256( (__m256i*)state[7], _mm256_add_epi32( h, _mm256_loadu_si256( (const __m256i*)state[7] ) ) );
+}
+
+#elif defined(_CTLE_SHA256_ARMV8)
+
+// block compression using the ARMv8 SHA2 instructions
+static void _sha256_compress_armv8( uint32_t *state, const uint8_t *blocks, size_t block_count )
+{
+	uint32x4_t state0 = vld1q_u32( &state[0] );
+	uint32x4_t state1 = vld1q_u32( &state[4] );
+
+	for( ; block_count > 0; --block_count, blocks += 64 )
+	{
+		const uint32x4_t abcd_save = state0;
+		const uint32x4_t efgh_save = state1;
+
+		uint32x4_t msg[4];
+		for( size_t i = 0; i < 4; ++i )
+			msg[i] = vreinterpretq_u32_u8( vrev32q_u8( vld1q_u8( &blocks[i*16] ) ) );
+
+		// 4 rounds per step, and the message words of 4 steps ahead are calculated from the current words
+		for( size_t i = 0; i < 16; ++i )
+		{
+			const uint32x4_t rounds_msg = vaddq_u32( msg[i & 3], vld1q_u32( &_sha256_round_constants[i*4] ) );
+			const uint32x4_t state0_prev = state0;
+			state0 = vsha256hq_u32( state0, state1, rounds_msg );
+			state1 = vsha256h2q_u32( state1, state0_prev, rounds_msg );
+
+			if( i < 12 )
+				msg[i & 3] = vsha256su1q_u32( vsha256su0q_u32( msg[i & 3], msg[(i + 1) & 3] ), msg[(i + 2) & 3], msg[(i + 3) & 3] );
+		}
+
+		state0 = vaddq_u32( state0, abcd_save );
+		state1 = vaddq_u32( state1, efgh_save );
+	}
+
+	vst1q_u32( &state[0], state0 );
+	vst1q_u32( &state[4], state1 );
+}
+
+// the extensions are enabled in the build, so they are always available
+static bool _sha256_has_cpu_extensions() { return true; }
+
+static const char *_sha256_cpu_extensions_name = "armv8";
+static void (*const _sha256_compress_cpu_extensions)( uint32_t*, const uint8_t*, size_t ) = &_sha256_compress_armv8;
+
+#endif
+
+static const uint32_t _sha256_initial_state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+
+// select the block compression function, the cpu is checked once
+static void (*_sha256_select_compress( bool use_cpu_extensions ))( uint32_t*, const uint8_t*, size_t )
+{
+#if defined(_CTLE_SHA256_X86) || defined(_CTLE_SHA256_ARMV8)
+	static const bool has_cpu_extensions = _sha256_has_cpu_extensions();
+	if( use_cpu_extensions && has_cpu_extensions )
+		return _sha256_compress_cpu_extensions;
+#else
+	(void)use_cpu_extensions;
+#endif
+	return &_sha256_compress_scalar;
+}
+
+// write the state as a big endian digest
+static digest<256> _sha256_state_to_digest( const uint32_t *state )
+{
+	digest<256> ret;
+	for( size_t i = 0; i < 8; ++i )
+	{
+		ret.data[i*4+0] = uint8_t( state[i] >> 24 );
+		ret.data[i*4+1] = uint8_t( state[i] >> 16 );
+		ret.data[i*4+2] = uint8_t( state[i] >> 8 );
+		ret.data[i*4+3] = uint8_t( state[i] );
+	}
+	return ret;
+}
+
+// copy the end of the message, which does not fill a full block, to the last block(s), and pad with a 1 bit and zeros, and end with the 
+// size of the message in bits. last_blocks must be 128 bytes, and zeroed. returns the number of last blocks
+static size_t _sha256_pad_last_blocks( uint8_t *last_blocks, const uint8_t *data, size_t size )
+{
+	const size_t rest_size = size % 64;
+	if( rest_size > 0 )
+		memcpy( last_blocks, &data[size - rest_size], rest_size );
+	last_blocks[rest_size] = 0x80;
+	const size_t last_blocks_size = ( rest_size < 56 ) ? 64 : 128;
+	const uint64_t total_bits = uint64_t(size) * 8;
+	for( size_t i = 0; i < 8; ++i )
+		last_blocks[last_blocks_size - 8 + i] = uint8_t( total_bits >> ( 56 - i * 8 ) );
+	return last_blocks_size / 64;
+}
+
+// hash a whole message with a block compression function
+static digest<256> _sha256_hash_buffer( void (*compress)( uint32_t*, const uint8_t*, size_t ), const uint8_t *data, size_t size )
+{
+	uint32_t state[8];
+	memcpy( state, _sha256_initial_state, sizeof(state) );
+
+	// compress the full blocks directly from the data, and the padded end of the message from the stack
+	const size_t block_count = size / 64;
+	if( block_count > 0 )
+		compress( state, data, block_count );
+	uint8_t last_blocks[128] = {};
+	compress( state, last_blocks, _sha256_pad_last_blocks( last_blocks, data, size ) );
+
+	return _sha256_state_to_digest( state );
+}
+
+#if defined(_CTLE_SHA256_X86)
+
+// hash the messages 8 at a time in the lanes of the AVX2 registers. when the message of a lane ends, the lane is refilled with 
+// the next message, so messages of different sizes keep all lanes busy until the last messages
+static void _sha256_hash_many_avx2( const uint8_t *const *data, const size_t *sizes, size_t count, digest<256> *out )
+{
+	struct lane_message
+	{
+		size_t index;
+		size_t block;
+		size_t full_block_count;
+		size_t block_count;
+		uint8_t last_blocks[128];
+	};
+	lane_message lanes[8];
+	bool lane_active[8] = {};
+	uint32_t state[8][8] = {};
+	const uint8_t *blocks[8];
+	static const uint8_t unused_block[64] = {};
+
+	// start the next message in a lane, if there are any messages left
+	size_t next_message = 0;
+	size_t active_lane_count = 0;
+	const auto start_message = [&]( size_t lane )
+	{
+		lane_active[lane] = ( next_message < count );
+		if( !lane_active[lane] )
+			return;
+		++active_lane_count;
+		lane_message &msg = lanes[lane];
+		msg.index = next_message++;
+		msg.block = 0;
+		msg.full_block_count = sizes[msg.index] / 64;
+		memset( msg.last_blocks, 0, sizeof(msg.last_blocks) );
+		msg.block_count = msg.full_block_count + _sha256_pad_last_blocks( msg.last_blocks, data[msg.index], sizes[msg.index] );
+		for( size_t w = 0; w < 8; ++w )
+			state[w][lane] = _sha256_initial_state[w];
+	};
+
+	for( size_t lane = 0; lane < 8; ++lane )
+		start_message( lane );
+
+	while( active_lane_count > 0 )
+	{
+		// compress the next block of each lane, the inactive lanes compress an unused block
+		for( size_t lane = 0; lane < 8; ++lane )
+		{
+			const lane_message &msg = lanes[lane];
+			if( !lane_active[lane] )
+				blocks[lane] = unused_block;
+			else if( msg.block < msg.full_block_count )
+				blocks[lane] = &data[msg.index][msg.block * 64];
+			else
+				blocks[lane] = &msg.last_blocks[( msg.block - msg.full_block_count ) * 64];
+		}
+		_sha256_compress_avx2_x8( state, blocks );
+
+		// write the digests of the ended messages, and start the next messages in their lanes
+		for( size_t lane = 0; lane < 8; ++lane )
+		{
+			if( !lane_active[lane] || ++lanes[lane].block < lanes[lane].block_count )
+				continue;
+			uint32_t lane_state[8];
+			for( size_t w = 0; w < 8; ++w )
+				lane_state[w] = state[w][lane];
+			out[lanes[lane].index] = _sha256_state_to_digest( lane_state );
+			--active_lane_count;
+			start_message( lane );
+		}
+	}
+}
+
+#endif
+
+void _sha256_hash_many( const uint8_t *const *data, const size_t *sizes, size_t count, digest<256> *out, bool use_sha_extensions )
+{
+#if defined(_CTLE_SHA256_X86)
+	static const bool has_sha_extensions = _sha256_has_cpu_extensions();
+	static const bool has_avx2 = _sha256_has_avx2();
+	if( count > 1 && has_avx2 && !( use_sha_extensions && has_sha_extensions ) )
+	{
+		_sha256_hash_many_avx2( data, sizes, count, out );
+		return;
+	}
+#endif
+
+	void (*const compress)( uint32_t*, const uint8_t*, size_t ) = _sha256_select_compress( use_sha_extensions );
+	for( size_t inx = 0; inx < count; ++inx )
+		out[inx] = _sha256_hash_buffer( compress, data[inx], sizes[inx] );
+}
+
+hasher_sha256_native::hasher_sha256_native( bool use_cpu_extensions )
+{
+	this->reset();
+	this->compress = _sha256_select_compress( use_cpu_extensions );
+}
+
+void hasher_sha256_native::reset()
+{
+	memcpy( this->state, _sha256_initial_state, sizeof(this->state) );
+	this->block_size = 0;
+	this->total_size = 0;
+}
+
+status hasher_sha256_native::update( const uint8_t *data, size_t size )
+{
+	this->total_size += size;
+
+	// fill up a partial block first
+	if( this->block_size > 0 )
+	{
+		const size_t count = std::min( size, sizeof(this->block) - this->block_size );
+		memcpy( &this->block[this->block_size], data, count );
+		this->block_size += count;
+		data += count;
+		size -= count;
+		if( this->block_size < sizeof(this->block) )
+			return status::ok;
+		this->compress( this->state, this->block, 1 );
+		this->block_size = 0;
+	}
+
+	// compress all full blocks directly from the data, and keep the rest
+	const size_t block_count = size / 64;
+	if( block_count > 0 )
+		this->compress( this->state, data, block_count );
+	this->block_size = size - block_count * 64;
+	memcpy( this->block, &data[block_count * 64], this->block_size );
+	return status::ok;
+}
+
+status_return<status, digest<256>> hasher_sha256_native::finish()
+{
+	// pad with a 1 bit and zeros, and end with the size of the message in bits, as a 64 bit big endian value
+	const uint64_t total_bits = this->total_size * 8;
+	uint8_t padding[72] = { 0x80 };
+	const size_t padding_size = ( ( this->block_size < 56 ) ? ( 56 - this->block_size ) : ( 120 - this->block_size ) );
+	for( size_t i = 0; i < 8; ++i )
+		padding[padding_size + i] = uint8_t( total_bits >> ( 56 - i * 8 ) );
+	this->update( padding, padding_size + 8 );
+
+	return _sha256_state_to_digest( this->state );
+}
+
+digest<256> _hash_single( const hasher_sha256 *, const uint8_t *data, size_t size )
+{
+	// same digest as picosha2, without allocating a context
+	return _hash_single( (const hasher_sha256_native*)nullptr, data, size );
+}
+
+digest<256> _hash_single( const hasher_sha256_native *, const uint8_t *data, size_t size )
+{
+	static void (*const compress)( uint32_t*, const uint8_t*, size_t ) = _sha256_select_compress( true );
+	return _sha256_hash_buffer( compress, data, size );
+}
+
+const char *hasher_sha256_native::get_implementation() const
+{
+#if defined(_CTLE_SHA256_X86) || defined(_CTLE_SHA256_ARMV8)
+	if( this->compress == _sha256_compress_cpu_extensions )
+		return _sha256_cpu_extensions_name;
+#endif
+	return "scalar";
+}
+
+}
+//namespace ctle
+
 namespace ctle
 {
 
@@ -153,6 +832,11 @@ status hasher_sha256::update(const uint8_t* data, size_t size)
 	return status::ok;
 }
 
+void hasher_sha256::reset()
+{
+	((picosha2::hash256_one_by_one*)this->context)->init();
+}
+
 status_return<status,digest<256>> hasher_sha256::finish()
 {
 	digest<256> ret;
@@ -167,26 +851,47 @@ status_return<status,digest<256>> hasher_sha256::finish()
 
 #ifdef XXHASH_H_5627135585666179
 
+// the XXH3 state is only stored in the object if XXH_STATIC_LINKING_ONLY is defined, so that the size of the state type can be 
+// checked. else, the layout of the state is unknown, and the state is allocated by xxHash.
+#ifdef XXH_STATIC_LINKING_ONLY
+
+#ifndef XXH3_INITSTATE
+#error XXH_STATIC_LINKING_ONLY must be defined before xxhash.h is included, so the XXH3 state type is defined
+#endif//XXH3_INITSTATE
+
+static_assert( sizeof(XXH3_state_t) <= _xxh3_state::size && alignof(XXH3_state_t) <= _xxh3_state::alignment, "The XXH3 state does not fit in _xxh3_state" );
+
+_xxh3_state::_xxh3_state() {}
+_xxh3_state::~_xxh3_state() {}
+void *_xxh3_state::get() { return (void*)( ( (uintptr_t)this->storage + alignment - 1 ) & ~(uintptr_t)( alignment - 1 ) ); }
+
+#else
+
+_xxh3_state::_xxh3_state() : allocated_state( XXH3_createState() ) {}
+_xxh3_state::~_xxh3_state() { XXH3_freeState( (XXH3_state_t*)this->allocated_state ); }
+void *_xxh3_state::get() { return this->allocated_state; }
+
+#endif//XXH_STATIC_LINKING_ONLY
+
 hasher_xxh64::hasher_xxh64()
 {
-	this->context = (void*)XXH3_createState();
-	XXH3_64bits_reset((XXH3_state_t*)this->context);
+	this->reset();
 }
 
-hasher_xxh64::~hasher_xxh64()
+void hasher_xxh64::reset()
 {
-	XXH3_freeState((XXH3_state_t*)this->context);
+	XXH3_64bits_reset((XXH3_state_t*)this->context.get());
 }
 
 status hasher_xxh64::update(const uint8_t* data, size_t size)
 {
-	XXH3_64bits_update((XXH3_state_t*)this->context, data, size);
+	XXH3_64bits_update((XXH3_state_t*)this->context.get(), data, size);
 	return status::ok;
 }
 
 status_return<status,digest<64>> hasher_xxh64::finish()
 {
-	XXH64_hash_t result = XXH3_64bits_digest((XXH3_state_t*)this->context);
+	XXH64_hash_t result = XXH3_64bits_digest((XXH3_state_t*)this->context.get());
 
 	XXH64_canonical_t canonical;
 	XXH64_canonicalFromHash( &canonical, result );
@@ -200,24 +905,23 @@ status_return<status,digest<64>> hasher_xxh64::finish()
 
 hasher_xxh128::hasher_xxh128()
 {
-	this->context = (void*)XXH3_createState();
-	XXH3_128bits_reset((XXH3_state_t*)this->context);
+	this->reset();
 }
 
-hasher_xxh128::~hasher_xxh128()
+void hasher_xxh128::reset()
 {
-	XXH3_freeState((XXH3_state_t*)this->context);
+	XXH3_128bits_reset((XXH3_state_t*)this->context.get());
 }
 
 status hasher_xxh128::update(const uint8_t* data, size_t size)
 {
-	XXH3_128bits_update((XXH3_state_t*)this->context, data, size);
+	XXH3_128bits_update((XXH3_state_t*)this->context.get(), data, size);
 	return status::ok;
 }
 
 status_return<status,digest<128>> hasher_xxh128::finish()
 {
-	XXH128_hash_t result = XXH3_128bits_digest((XXH3_state_t*)this->context);
+	XXH128_hash_t result = XXH3_128bits_digest((XXH3_state_t*)this->context.get());
 
 	XXH128_canonical_t canonical;
 	XXH128_canonicalFromHash( &canonical, result );
@@ -232,18 +936,17 @@ status_return<status,digest<128>> hasher_xxh128::finish()
 
 hasher_2x_xxh128_dcb7be9cd0fcf505::hasher_2x_xxh128_dcb7be9cd0fcf505()
 {
-	this->context = (void*)XXH3_createState();
-	XXH3_128bits_reset((XXH3_state_t*)this->context);
+	this->reset();
 }
 
-hasher_2x_xxh128_dcb7be9cd0fcf505::~hasher_2x_xxh128_dcb7be9cd0fcf505()
+void hasher_2x_xxh128_dcb7be9cd0fcf505::reset()
 {
-	XXH3_freeState((XXH3_state_t*)this->context);
+	XXH3_128bits_reset((XXH3_state_t*)this->context.get());
 }
 
 status hasher_2x_xxh128_dcb7be9cd0fcf505::update(const uint8_t* data, size_t size)
 {
-	XXH3_128bits_update((XXH3_state_t*)this->context, data, size);
+	XXH3_128bits_update((XXH3_state_t*)this->context.get(), data, size);
 	return status::ok;
 }
 
@@ -252,23 +955,79 @@ status_return<status,digest<256>> hasher_2x_xxh128_dcb7be9cd0fcf505::finish()
 	digest<256> ret;
 
 	// get the first hash result, and copy to return
-	XXH128_hash_t result = XXH3_128bits_digest((XXH3_state_t*)this->context);
+	XXH128_hash_t result = XXH3_128bits_digest((XXH3_state_t*)this->context.get());
 	XXH128_canonical_t canonical;
 	XXH128_canonicalFromHash( &canonical, result );
 	memcpy( &ret.data[0], canonical.digest, sizeof(canonical.digest) );
 
 	// append the randomly generated salt 'dcb7be9cd0fcf505' to the state
 	const static u8 salt[8] = {0xdc,0xb7,0xbe,0x9c,0xd0,0xfc,0xf5,0x05};
-	XXH3_128bits_update((XXH3_state_t*)this->context, salt, sizeof(salt) );
+	XXH3_128bits_update((XXH3_state_t*)this->context.get(), salt, sizeof(salt) );
 
 	// get the second hash result, and copy to second part of return
-	result = XXH3_128bits_digest((XXH3_state_t*)this->context);
+	result = XXH3_128bits_digest((XXH3_state_t*)this->context.get());
 	XXH128_canonicalFromHash( &canonical, result );
 	memcpy( &ret.data[16], canonical.digest, sizeof(canonical.digest) );
 
 	return ret;
 }
 
+///////////////////
+
+digest<64> _hash_single( const hasher_xxh64 *, const uint8_t *data, size_t size )
+{
+	XXH64_canonical_t canonical;
+	XXH64_canonicalFromHash( &canonical, XXH3_64bits( data, size ) );
+
+	digest<64> ret;
+	memcpy( ret.data, canonical.digest, sizeof(ret.data) );
+	return ret;
+}
+
+digest<128> _hash_single( const hasher_xxh128 *, const uint8_t *data, size_t size )
+{
+	XXH128_canonical_t canonical;
+	XXH128_canonicalFromHash( &canonical, XXH3_128bits( data, size ) );
+
+	digest<128> ret;
+	memcpy( ret.data, canonical.digest, sizeof(ret.data) );
+	return ret;
+}
+
+digest<256> _hash_single( const hasher_2x_xxh128_dcb7be9cd0fcf505 *, const uint8_t *data, size_t size )
+{
+	digest<256> ret;
+
+	// the first hash is of the data
+	XXH128_canonical_t canonical;
+	XXH128_canonicalFromHash( &canonical, XXH3_128bits( data, size ) );
+	memcpy( &ret.data[0], canonical.digest, sizeof(canonical.digest) );
+
+	// the second hash is of the data with the salt appended. short data is copied with the salt to the stack and hashed single-shot,
+	// longer data is hashed using a state which is reused by the thread
+	const static u8 salt[8] = {0xdc,0xb7,0xbe,0x9c,0xd0,0xfc,0xf5,0x05};
+	if( size <= 248 )
+	{
+		u8 salted[256];
+		if( size > 0 )
+			memcpy( salted, data, size );
+		memcpy( &salted[size], salt, sizeof(salt) );
+		XXH128_canonicalFromHash( &canonical, XXH3_128bits( salted, size + sizeof(salt) ) );
+		memcpy( &ret.data[16], canonical.digest, sizeof(canonical.digest) );
+		return ret;
+	}
+
+	thread_local _xxh3_state state;
+	XXH3_state_t *context = (XXH3_state_t*)state.get();
+	XXH3_128bits_reset( context );
+	XXH3_128bits_update( context, data, size );
+	XXH3_128bits_update( context, salt, sizeof(salt) );
+	XXH128_canonicalFromHash( &canonical, XXH3_128bits_digest( context ) );
+	memcpy( &ret.data[16], canonical.digest, sizeof(canonical.digest) );
+
+	return ret;
+}
+
 #endif//XXHASH_H_5627135585666179
 
 ////////////////////////////////////////
@@ -0,0 +1,272 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+#pragma once
+#ifndef _CTLE_HASHER_TREE_H_
+#define _CTLE_HASHER_TREE_H_
+
+/// @file hasher_tree.h
+/// @brief A tree hasher, which hashes fixed size leaves of the input in parallel, and combines the leaf hashes in a Merkle tree.
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <string.h>
+
+#include "fwd.h"
+#include "status.h"
+#include "status_return.h"
+#include "status_error.h"
+#include "digest.h"
+#include "hasher.h"
+#include "task_worker.h"
+
+namespace ctle
+{
+
+/// @brief A tree hasher, which splits the input into fixed size leaves, hashes the leaves in parallel, and combines the leaf hashes
+/// in a binary Merkle tree into a 256 bit root hash. Can be used as the hasher of read_stream and write_stream.
+/// @details Each leaf hash is the hash of a 0x00 byte followed by the leaf data, and each node of the tree is the hash of a 0x01 byte
+/// followed by the hashes of its two children, so leaves and nodes can not be confused. At each level of the tree, an odd last
+/// node is moved up to the next level unchanged. An empty input has a single empty leaf.
+/// The data of each full leaf is copied to a leaf buffer, and hashed on one of thread_count persistent worker threads (see task_worker),
+/// with up to thread_count leaves hashed at the same time, so the hashing scales with the number of cores. The leaf hashes are kept after finish(), and can be used to verify
+/// ranges of the data independently (see hash_leaf and hash_root). The root hash depends on the leaf size, but not on how the data
+/// is split into update() calls.
+/// @tparam _LeafHashTy the hasher of the leaves and nodes, which must have a 256 bit hash, e.g. hasher_sha256_native
+template<class _LeafHashTy>
+class hasher_tree
+{
+public:
+	static_assert( std::is_same<typename _LeafHashTy::hash_type, digest<256>>::value, "The leaf hasher of hasher_tree must have a 256 bit hash" );
+	using hash_type = digest<256>;
+
+	/// @brief The default size of the leaves
+	static constexpr size_t default_leaf_size = 1024 * 1024;
+
+	/// @brief Create the hasher
+	/// @param _leaf_size the size of the leaves
+	/// @param _thread_count the number of worker threads, which is the max number of leaves which are hashed at the same time. If 0, the 
+	/// number of hardware threads is used. The worker threads are started when they are first needed.
+	hasher_tree( size_t _leaf_size = default_leaf_size, size_t _thread_count = 0 );
+	~hasher_tree();
+
+	hasher_tree( const hasher_tree & ) = delete;
+	hasher_tree &operator=( const hasher_tree & ) = delete;
+
+	/// @copydoc hasher_noop::update
+	status update(const uint8_t* data, size_t size);
+
+	/// @copydoc hasher_noop::finish
+	status_return<status, digest<256>> finish();
+
+	/// @brief Reset the hasher for a new stream. Waits for leaves which are being hashed, and keeps the leaf buffers for reuse.
+	void reset();
+
+	/// @brief Get the size of the leaves
+	size_t get_leaf_size() const { return this->leaf_size; }
+
+	/// @brief Get the hashes of the leaves, in order. All leaf hashes are available after finish().
+	const std::vector<digest<256>> &get_leaf_digests() const { return this->leaf_digests; }
+
+	/// @brief Hash the data of a leaf
+	static digest<256> hash_leaf( const uint8_t *data, size_t size );
+
+	/// @brief Calculate the root hash of the tree of a number of leaf hashes (the same as finish returns)
+	static digest<256> hash_root( const digest<256> *leaf_digests, size_t leaf_count );
+
+private:
+	struct pending_leaf
+	{
+		std::unique_ptr<uint8_t[]> buffer;
+		size_t leaf_index;
+		size_t worker_index;
+		digest<256> result;
+	};
+
+	size_t leaf_size = 0;
+	size_t thread_count = 0;
+
+	// the leaves are dispatched to the workers in turn, so each worker has at most one pending leaf
+	std::unique_ptr<task_worker[]> workers;
+	size_t next_worker = 0;
+
+	std::unique_ptr<uint8_t[]> leaf_buffer;
+	size_t leaf_buffer_size = 0;
+	std::vector<std::unique_ptr<uint8_t[]>> free_leaf_buffers;
+	std::deque<pending_leaf> pending_leaves;
+	std::vector<digest<256>> leaf_digests;
+
+	static digest<256> hash_node( const digest<256> &left, const digest<256> &right );
+	void dispatch_leaf();
+	void complete_oldest_leaf();
+};
+
+}
+// namespace ctle
+
+#include "log.h"
+#include "_macros.inl"
+
+namespace ctle
+{
+
+template<class _LeafHashTy>
+inline hasher_tree<_LeafHashTy>::hasher_tree( size_t _leaf_size, size_t _thread_count )
+	: leaf_size(_leaf_size)
+	, thread_count(_thread_count)
+{
+	ctValidate( this->leaf_size > 0, status::invalid_param ) << "The leaf size of the tree hasher can not be 0" << ctValidateThrow;
+	if( this->thread_count == 0 )
+		this->thread_count = std::max( (size_t)std::thread::hardware_concurrency(), (size_t)1 );
+	this->workers.reset( new task_worker[this->thread_count] );
+}
+
+template<class _LeafHashTy>
+inline hasher_tree<_LeafHashTy>::~hasher_tree()
+{
+	// the leaves which are being hashed use the leaf buffers, so wait for them before the buffers are released
+	for( auto &leaf : this->pending_leaves )
+		this->workers[leaf.worker_index].wait();
+}
+
+template<class _LeafHashTy>
+inline digest<256> hasher_tree<_LeafHashTy>::hash_leaf( const uint8_t *data, size_t size )
+{
+	const uint8_t leaf_prefix = 0x00;
+	_LeafHashTy hasher;
+	hasher.update( &leaf_prefix, 1 );
+	if( size > 0 )
+		hasher.update( data, size );
+	return hasher.finish().value();
+}
+
+template<class _LeafHashTy>
+inline digest<256> hasher_tree<_LeafHashTy>::hash_node( const digest<256> &left, const digest<256> &right )
+{
+	const uint8_t node_prefix = 0x01;
+	_LeafHashTy hasher;
+	hasher.update( &node_prefix, 1 );
+	hasher.update( left.data, sizeof(left.data) );
+	hasher.update( right.data, sizeof(right.data) );
+	return hasher.finish().value();
+}
+
+template<class _LeafHashTy>
+inline digest<256> hasher_tree<_LeafHashTy>::hash_root( const digest<256> *leaf_digests, size_t leaf_count )
+{
+	if( leaf_count == 0 )
+		return hash_leaf( nullptr, 0 );
+
+	// combine pairs of nodes, level by level, until the root remains
+	std::vector<digest<256>> level( leaf_digests, leaf_digests + leaf_count );
+	while( level.size() > 1 )
+	{
+		size_t level_size = 0;
+		for( size_t inx = 0; inx < level.size(); inx += 2 )
+		{
+			if( inx + 1 < level.size() )
+				level[level_size++] = hash_node( level[inx], level[inx + 1] );
+			else
+				level[level_size++] = level[inx];
+		}
+		level.resize( level_size );
+	}
+	return level[0];
+}
+
+template<class _LeafHashTy>
+inline status hasher_tree<_LeafHashTy>::update( const uint8_t *data, size_t size )
+{
+	while( size > 0 )
+	{
+		// start a new leaf, reusing the buffer of a hashed leaf if possible
+		if( !this->leaf_buffer )
+		{
+			if( !this->free_leaf_buffers.empty() )
+			{
+				this->leaf_buffer = std::move( this->free_leaf_buffers.back() );
+				this->free_leaf_buffers.pop_back();
+			}
+			else
+			{
+				this->leaf_buffer.reset( new uint8_t[this->leaf_size] );
+			}
+			this->leaf_buffer_size = 0;
+		}
+
+		// copy into the leaf, and hash the leaf when it is full
+		const size_t count = std::min( size, this->leaf_size - this->leaf_buffer_size );
+		memcpy( &this->leaf_buffer[this->leaf_buffer_size], data, count );
+		this->leaf_buffer_size += count;
+		data += count;
+		size -= count;
+		if( this->leaf_buffer_size == this->leaf_size )
+			this->dispatch_leaf();
+	}
+	return status::ok;
+}
+
+template<class _LeafHashTy>
+inline void hasher_tree<_LeafHashTy>::dispatch_leaf()
+{
+	// limit the number of leaves which are hashed at the same time
+	if( this->pending_leaves.size() >= this->thread_count )
+		this->complete_oldest_leaf();
+
+	// hash the leaf on the next worker. (the deque does not move its elements when adding and removing at the ends, 
+	// so the worker can write the result directly to the pending leaf)
+	this->leaf_digests.emplace_back();
+	this->pending_leaves.push_back( { std::move( this->leaf_buffer ), this->leaf_digests.size() - 1, this->next_worker, digest<256>() } );
+	pending_leaf &leaf = this->pending_leaves.back();
+	const uint8_t *data = leaf.buffer.get();
+	const size_t size = this->leaf_buffer_size;
+	digest<256> *result = &leaf.result;
+	this->workers[leaf.worker_index].submit( [data,size,result]() { *result = hash_leaf( data, size ); return status( status::ok ); } );
+	this->next_worker = ( this->next_worker + 1 ) % this->thread_count;
+	this->leaf_buffer_size = 0;
+}
+
+template<class _LeafHashTy>
+inline void hasher_tree<_LeafHashTy>::complete_oldest_leaf()
+{
+	pending_leaf &leaf = this->pending_leaves.front();
+	this->workers[leaf.worker_index].wait();
+	this->leaf_digests[leaf.leaf_index] = leaf.result;
+	this->free_leaf_buffers.push_back( std::move( leaf.buffer ) );
+	this->pending_leaves.pop_front();
+}
+
+template<class _LeafHashTy>
+inline void hasher_tree<_LeafHashTy>::reset()
+{
+	while( !this->pending_leaves.empty() )
+		this->complete_oldest_leaf();
+	this->leaf_digests.clear();
+	this->leaf_buffer_size = 0;
+}
+
+template<class _LeafHashTy>
+inline status_return<status, digest<256>> hasher_tree<_LeafHashTy>::finish()
+{
+	// hash the last partial leaf (or the single empty leaf of an empty input)
+	if( this->leaf_buffer_size > 0 || this->leaf_digests.empty() )
+	{
+		this->leaf_digests.push_back( hash_leaf( this->leaf_buffer.get(), this->leaf_buffer_size ) );
+		this->leaf_buffer_size = 0;
+	}
+
+	while( !this->pending_leaves.empty() )
+		this->complete_oldest_leaf();
+
+	return hash_root( this->leaf_digests.data(), this->leaf_digests.size() );
+}
+
+}
+// namespace ctle
+
+#include "_undef_macros.inl"
+
+#endif//_CTLE_HASHER_TREE_H_
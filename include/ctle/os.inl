@@ -59,6 +59,10 @@ private:
 #include <spawn.h>
 #include <fcntl.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <errno.h>
 #include <cstring>
 
 // RAII wrapper for Linux file handles
@@ -125,7 +125,7 @@ private:
 
 #if defined(_WIN32)
 #define _ADD_CTLE_HEADERS_WIN_SOCKETS
-#elif defined(linux)
+#elif defined(__linux__)
 #define _ADD_CTLE_HEADERS_LINUX_SOCKETS
 #endif
 #include "os.inl"
@@ -504,7 +504,7 @@ bool process::has_exited()
 	return !this->is_running();
 }
 
-#elif defined(linux)
+#elif defined(__linux__)
 
 std::string get_current_executable_path() 
 {
@@ -782,7 +782,7 @@ bool process::has_exited()
 	return !this->is_running();
 }
 
-#endif//defined(_WIN32) elif defined(linux)
+#endif//defined(_WIN32) elif defined(__linux__)
 
 }
 // namespace ctle
@@ -8,30 +8,90 @@
 /// @brief A read-only input stream for streaming data sequentially, using a memory buffer, while also calculating a hash on the input stream.
 
 #include <vector>
+#include <type_traits>
+#include <memory>
 
 #include "fwd.h"
 #include "status_error.h"
 #include "status_return.h"
 #include "hasher.h"
+#include "transform.h"
 #include "file_funcs.h"
+#include "endianness.h"
+#include "varint.h"
+#include "task_worker.h"
 
 namespace ctle
 {
+/// @brief Checks if a data source is memory mapped, in which case the read_stream reads directly from the mapped memory.
+/// @details A memory mapped data source defines a static constexpr bool is_memory_mapped = true, and implements 
+/// the data() and size() methods, which return the mapped memory and its size. (See mmap_data_source)
+template<class _DataSourceTy, class = void> struct is_memory_mapped_data_source : std::false_type {};
+template<class _DataSourceTy> struct is_memory_mapped_data_source<_DataSourceTy, typename std::enable_if<_DataSourceTy::is_memory_mapped>::type> : std::true_type {};
+
+/// @brief Checks if a data source is seekable, in which case the read_stream can seek in the stream, and read a block index.
+/// @details A seekable data source implements a seek(u64 position) method which sets the position of the next read, and 
+/// a size() method which returns the size of the source. (See file_data_source and mmap_data_source)
+template<class _DataSourceTy, class = void> struct is_seekable_data_source : std::false_type {};
+template<class _DataSourceTy> struct is_seekable_data_source<_DataSourceTy, decltype( (void)std::declval<_DataSourceTy&>().seek( u64() ), (void)std::declval<const _DataSourceTy&>().size() )> : std::true_type {};
+
+/// @brief Flags for setting up a read_stream
+enum class read_stream_flags : int
+{
+	async_read = 0x1,	///< Prefetch the next buffer from the data source on a background thread, while the current buffer is being read. (Ignored for memory mapped data sources.)
+	async_hash = 0x2,	///< Hash the filled buffers on a worker thread, while the data is being read from the buffer. 
+	block_index = 0x4,	///< Read the block index footer written by a write_stream with write_stream_flags::block_index. (Requires a seekable data source.)
+};
+
 /// @brief A read-only input stream with optional hashing
 /// @details A read-only input stream which is designed for streaming data sequentially, using a 
-/// memory buffer, while also calculating a hash on the input stream.
-template<class _DataSourceTy, class _HashTy /* = hasher_noop<64> */>
+/// memory buffer, while also calculating a hash on the input stream. If the data source is memory mapped 
+/// (see is_memory_mapped_data_source), the stream reads directly from the mapped memory instead of the buffer.
+/// With the read_stream_flags::async_read flag, the stream uses two buffers, and reads the next buffer from the data 
+/// source on a persistent worker thread while the current buffer is being read, so reading from the source overlaps with 
+/// the processing of the data.
+/// With the read_stream_flags::async_hash flag, each filled buffer is hashed on a persistent worker thread (in stream order), so hashing
+/// runs concurrently with reading from the source and with the parsing of the data. The final hash is ready when the stream has ended.
+/// The buffer size can be set in the constructor, and the caller can also supply a buffer to use, which lets 
+/// short-lived streams reuse the same (e.g. aligned or huge page) memory instead of allocating a new buffer for each stream.
+/// The _TransformTy transform stage decodes the blocks written by a write_stream with the same transform (e.g. transform_lz
+/// to decompress), before the data is buffered and hashed. The default transform_noop reads the source data as is.
+/// If the data source is seekable (see is_seekable_data_source), the stream can seek to any position of the stream data. With the
+/// read_stream_flags::block_index flag, the block index footer is read on construction, so the stream can seek directly to the 
+/// start of record N (see write_stream::mark_record), and the footer is not read as part of the stream data.
+template<class _DataSourceTy, class _HashTy /* = hasher_noop<64> */, class _TransformTy /* = transform_noop */>
 class read_stream
 {
-	const size_t buffer_size = 2 * 1024 * 1024;
-
 public:
-	read_stream( _DataSourceTy &_data_source );
+	/// @brief The default size of the stream buffer
+	static constexpr size_t default_buffer_size = 2 * 1024 * 1024;
+
+	/// @brief The id which ends a block index footer (matches write_stream::block_index_id)
+	static constexpr u64 block_index_id = 0x63746c65696e6478; // "ctleindx"
+
+	/// @brief The max decoded size of a transformed block, larger block headers are rejected as corrupted (matches write_stream::max_block_size)
+	static constexpr size_t max_block_size = 64 * 1024 * 1024;
+
+	/// @brief Create a read stream which allocates its own buffer
+	/// @details The buffer is aligned to _file_object::unbuffered_alignment, for unbuffered file sources.
+	/// @param _data_source the data source to read from
+	/// @param flags setup flags for the stream
+	/// @param _buffer_size the size of the buffer (in async_read mode, two buffers of this size are allocated)
+	read_stream( _DataSourceTy &_data_source, read_stream_flags flags = {}, size_t _buffer_size = default_buffer_size );
+
+	/// @brief Create a read stream which uses a buffer supplied by the caller
+	/// @param _data_source the data source to read from
+	/// @param external_buffer the buffer memory to use, must stay valid for the lifetime of the stream
+	/// @param external_buffer_size the size of the buffer memory (in async_read mode, the memory is split into two buffers)
+	/// @param flags setup flags for the stream
+	read_stream( _DataSourceTy &_data_source, u8* external_buffer, size_t external_buffer_size, read_stream_flags flags = {} );
+
 	~read_stream();
 
 	using data_source_type = _DataSourceTy;
 	using hasher_type = _HashTy;
 	using hash_type = typename _HashTy::hash_type;
+	using transform_type = _TransformTy;
 
 	/// @brief Get the current position/number of bytes read from the stream (not including any pre-read data in the read buffer)
 	u64 get_position() const { return this->current_position; };
@@ -49,12 +109,56 @@ public:
 	/// @note Make sure the type is correctly packed, since any alignment byte will also be read from the stream
 	template<class _DataTy> status read(_DataTy* dest, size_t count = 1);
 
+	/// @brief Read a number of big-endian values from the stream, and convert them to the native byte order of the host.
+	/// @details On little-endian hosts, the byte order is swapped while the values are copied out of the stream buffer, so the data is only 
+	/// touched once. On big-endian hosts, the values are copied as is. (see copy_bigendian)
+	/// @note The type must be trivially copyable, and have a size of 1, 2, 4 or 8 bytes (see byte_order_swap_type)
+	template<class _DataTy> status read_bigendian(_DataTy* dest, size_t count = 1);
+
+	/// @brief Read a single varint encoded integer value from the stream. If at the end of the stream, or if the encoding is invalid, 0 is returned.
+	template<class _DataTy> _DataTy read_varint();
+
+	/// @brief Read a number of varint (LEB128) encoded integer values from the stream. Signed values are zigzag decoded. (See varint.h)
+	/// @details Returns status::corrupted if the encoding of a value is invalid, or status::cant_read if the stream ended before all values were read.
+	template<class _DataTy> status read_varint(_DataTy* dest, size_t count = 1);
+
 	/// @brief Read a raw byte stream into a memory area
 	/// @param dest the destination memory area
 	/// @param count the number of bytes to read
 	/// @note dest must be a valid memory area of at least count bytes
 	status read_bytes(u8* dest, size_t count);
 
+	/// @brief Read a raw byte span from the stream, without copying the data.
+	/// @details Returns a pointer to count contiguous bytes in the stream, and advances the stream past the bytes. 
+	/// For memory mapped data sources, the pointer points directly into the mapped memory, and stays valid for the lifetime 
+	/// of the data source. For other data sources, the pointer points into the stream buffer, and is only valid until the 
+	/// next read from the stream, and count can not be larger than the buffer size.
+	/// @param count the number of bytes to read
+	/// @return status::ok and a pointer to the bytes, or an error if the stream ended before count bytes could be read
+	status_return<status, const u8*> read_span(size_t count);
+
+	/// @brief Seek to a position in the stream, which requires a seekable data source, and a stream without a transform.
+	/// @details If the position is within the current buffer, the buffer is reused, else the buffer is refilled from the new 
+	/// position in the data source. Since data is then skipped or read again, the stream data is no longer hashed after
+	/// seeking outside of the buffer, and get_digest() returns an empty digest.
+	/// @param position the new position in the stream, which can not be beyond the end of the stream data
+	/// @return status::ok, or status::invalid_param if the position is beyond the end of the stream data, or if the stream is transformed
+	status seek(u64 position);
+
+	/// @brief Seek to the start of a record in the block index. (See read_stream_flags::block_index)
+	/// @param record_index the index of the record
+	/// @return status::ok, or status::invalid_param if the record index is out of range
+	status seek_record(size_t record_index);
+
+	/// @brief Get the number of records in the block index. (0 if the stream has no block index)
+	size_t get_record_count() const { return this->block_index.size(); }
+
+	/// @brief Get the block index, which is the stream positions of the records. (empty if the stream has no block index)
+	const std::vector<u64> &get_block_index() const { return this->block_index; }
+
+	/// @brief Get the size of the stream buffer
+	size_t get_buffer_size() const { return this->buffer_size; }
+
 	/// @brief Returns true if the stream has ended (eos/eof)
 	bool has_ended() const;
 
@@ -63,17 +167,71 @@ public:
 	status_return<status,hash_type> get_digest() const { return hash_digest; };
 
 private:
+	// mapped sources are read directly, unless the data needs to be decoded by the transform
+	using is_memory_mapped = std::integral_constant<bool, is_memory_mapped_data_source<_DataSourceTy>::value && _TransformTy::is_noop>;
+	using is_noop_transform = std::integral_constant<bool, _TransformTy::is_noop>;
+	using is_seekable = is_seekable_data_source<_DataSourceTy>;
+
 	u64 current_position = 0;
 	size_t buffer_position = 0;
 	size_t buffer_end = 0;
-	std::vector<u8> buffer;
+	bool source_ended = false;
+	bool async_read = false;
+	bool async_hash = false;
+	bool hashing_stopped = false;
+	const u8* stream_data = nullptr;
+	size_t buffer_size = 0;
+	u8* buffer = nullptr;
+	u8* back_buffer = nullptr;
+	std::unique_ptr<u8[]> allocated_buffer;
+	std::vector<u8> span_buffer;
 
 	data_source_type &data_source;
 	hasher_type hasher;
 	hash_type hash_digest;
 
+	// the transform, and the current encoded and decoded blocks
+	transform_type transform;
+	std::vector<u8> encoded_block;
+	std::vector<u8> decoded_block;
+	size_t decoded_position = 0;
+
+	// the position of the next read from the data source, and the size of the stream data in the source, 
+	// which excludes the block index footer, if the source has one
+	u64 source_position = 0;
+	u64 data_size = ~u64(0);
+	std::vector<u64> block_index;
+
+	// the worker which reads the next buffer into the back buffer, in async_read mode, and the size of the pending read
+	task_worker read_worker;
+	bool prefetch_pending = false;
+	u64 prefetch_count = 0;
+
+	// the worker which hashes the filled data, in async_hash mode
+	task_worker hash_worker;
+
+	void setup( read_stream_flags flags, u8* external_buffer, size_t _buffer_size );
+	void setup_stream_data( std::false_type, u8* external_buffer );
+	void setup_stream_data( std::true_type, u8* external_buffer );
 	void read_from_buffer( u8* const dest, const size_t count );
 	status fill_buffer();
+	status fill_buffer( std::false_type );
+	status fill_buffer( std::true_type );
+	status swap_buffers();
+	void start_prefetch();
+	void drop_prefetch();
+	status hash_data( const u8* src, size_t count, bool last );
+	status_return<status, u64> read_source( u8* dest, u64 count );
+	status_return<status, u64> read_source( std::true_type, u8* dest, u64 count );
+	status_return<status, u64> read_source( std::false_type, u8* dest, u64 count );
+	status_return<status, u64> read_source_exact( u8* dest, u64 count );
+	status_return<status, bool> read_block();
+	template<class _DataTy> status read_varint_bytewise( _DataTy* dest );
+	status wait_for_pending_hash();
+	status read_block_index( std::true_type );
+	status read_block_index( std::false_type );
+	status seek( std::true_type, u64 position );
+	status seek( std::false_type, u64 position );
 };
 
 }
@@ -84,31 +242,83 @@ private:
 namespace ctle
 {
 
-template<class _DataSourceTy, class _HashTy>
-inline read_stream<_DataSourceTy,_HashTy>::read_stream( _DataSourceTy &_data_source ) 
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_stream( _DataSourceTy &_data_source, read_stream_flags flags, size_t _buffer_size ) 
 	: data_source(_data_source)
 {
-	this->buffer.resize(buffer_size);
+	this->setup( flags, nullptr, _buffer_size );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_stream( _DataSourceTy &_data_source, u8* external_buffer, size_t external_buffer_size, read_stream_flags flags ) 
+	: data_source(_data_source)
+{
+	ctValidate( external_buffer != nullptr, status::invalid_param ) << "The external buffer must be a valid memory area" << ctValidateThrow;
+	this->setup( flags, external_buffer, external_buffer_size );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline read_stream<_DataSourceTy,_HashTy,_TransformTy>::~read_stream()
+{
+	// make sure the background read and hashing are done before the buffers are released
+	this->drop_prefetch();
+	if( this->async_hash )
+		this->hash_worker.wait();
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline void read_stream<_DataSourceTy,_HashTy,_TransformTy>::setup( read_stream_flags flags, u8* external_buffer, size_t _buffer_size )
+{
+	this->async_read = ( (int)flags & (int)read_stream_flags::async_read ) && !is_memory_mapped::value;
+	this->async_hash = ( (int)flags & (int)read_stream_flags::async_hash );
+
+	// in async_read mode, external buffer memory is split into two buffers
+	this->buffer_size = ( external_buffer && this->async_read ) ? ( _buffer_size / 2 ) : ( _buffer_size );
+	ctValidate( this->buffer_size > 0, status::invalid_param ) << "The buffer size of the stream can not be 0" << ctValidateThrow;
+
+	this->setup_stream_data( is_memory_mapped(), external_buffer );
+	if( (int)flags & (int)read_stream_flags::block_index )
+		ctStatusCallThrow( this->read_block_index( is_seekable() ) );
 	ctStatusCallThrow( this->fill_buffer() );
 }
 
-template<class _DataSourceTy, class _HashTy>
-inline read_stream<_DataSourceTy,_HashTy>::~read_stream()
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline void read_stream<_DataSourceTy,_HashTy,_TransformTy>::setup_stream_data( std::false_type, u8* external_buffer )
 {
+	// allocate the buffer(s) if not supplied by the caller. (the allocation is not initialized, since it is filled from the source)
+	if( !external_buffer )
+	{
+		// the buffer is aligned for unbuffered file reads (see _file_object::open_read)
+		const size_t alignment = _file_object::unbuffered_alignment;
+		this->allocated_buffer.reset( new u8[ ( ( this->async_read ) ? ( this->buffer_size * 2 ) : ( this->buffer_size ) ) + alignment - 1 ] );
+		external_buffer = (u8*)( ( (uintptr_t)this->allocated_buffer.get() + alignment - 1 ) & ~(uintptr_t)( alignment - 1 ) );
+	}
+
+	this->buffer = external_buffer;
+	if( this->async_read )
+		this->back_buffer = &external_buffer[this->buffer_size];
+	this->stream_data = this->buffer;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline void read_stream<_DataSourceTy,_HashTy,_TransformTy>::setup_stream_data( std::true_type, u8* /*external_buffer*/ )
+{
+	// memory mapped sources are read directly, so no buffer is allocated
+	this->stream_data = this->data_source.data();
 }
 
-template<class _DataSourceTy, class _HashTy>
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
 template<class _DataTy>
-inline _DataTy read_stream<_DataSourceTy,_HashTy>::read()
+inline _DataTy read_stream<_DataSourceTy,_HashTy,_TransformTy>::read()
 {
 	_DataTy ret = {};
 	this->read<_DataTy>( &ret );
 	return ret;
 }
 
-template<class _DataSourceTy, class _HashTy>
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
 template<class _DataTy>
-inline status read_stream<_DataSourceTy,_HashTy>::read(_DataTy* dest, size_t count)
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read(_DataTy* dest, size_t count)
 {
 	static_assert( std::is_trivially_copyable<_DataTy>(), "_DataTy data type must be trivially copyable" );
 
@@ -116,8 +326,115 @@ inline status read_stream<_DataSourceTy,_HashTy>::read(_DataTy* dest, size_t cou
 	return status::ok;
 }
 
-template<class _DataSourceTy, class _HashTy>
-inline status read_stream<_DataSourceTy,_HashTy>::read_bytes(u8* const dest, const size_t count)
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_bigendian(_DataTy* dest, size_t count)
+{
+	static_assert( std::is_trivially_copyable<_DataTy>(), "_DataTy data type must be trivially copyable" );
+	using swap_type = typename byte_order_swap_type<sizeof(_DataTy)>::type;
+
+	size_t read_values = 0;
+	while( read_values < count )
+	{
+		const size_t in_buffer = (this->buffer_end - this->buffer_position) / sizeof(_DataTy);
+		const size_t to_read = std::min(count - read_values, in_buffer);
+		if( to_read > 0 )
+		{
+			// copy and convert the whole values which are in the buffer
+			copy_bigendian<swap_type>( &dest[read_values], &this->stream_data[this->buffer_position], to_read );
+			this->buffer_position += to_read * sizeof(_DataTy);
+			this->current_position += to_read * sizeof(_DataTy);
+			read_values += to_read;
+
+			// if we are at the end of the buffer, fill it with new data
+			if (this->buffer_position >= this->buffer_end)
+				ctStatusCall(this->fill_buffer());
+		}
+		else
+		{
+			// the next value straddles the end of the buffer, so read it using read_bytes, and convert it in place
+			ctStatusCall(this->read_bytes( (u8*)&dest[read_values], sizeof(_DataTy) ));
+			copy_bigendian<swap_type>( &dest[read_values], &dest[read_values], 1 );
+			++read_values;
+		}
+	}
+
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline _DataTy read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_varint()
+{
+	_DataTy ret = {};
+	this->read_varint<_DataTy>( &ret );
+	return ret;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_varint(_DataTy* dest, size_t count)
+{
+	static_assert( std::is_integral<_DataTy>(), "_DataTy data type must be an integer type" );
+	const size_t max_size = varint_max_size<_DataTy>::value;
+
+	size_t read_values = 0;
+	while( read_values < count )
+	{
+		// decode as many values as possible directly from the buffer
+		size_t decoded_count = 0;
+		const size_t decoded_size = varint_decode( &this->stream_data[this->buffer_position], this->buffer_end - this->buffer_position, &dest[read_values], count - read_values, &decoded_count );
+		this->buffer_position += decoded_size;
+		this->current_position += decoded_size;
+		read_values += decoded_count;
+		if( read_values == count )
+			break;
+
+		const size_t in_buffer = this->buffer_end - this->buffer_position;
+		if( in_buffer == 0 )
+		{
+			// the buffer is empty, fill it with new data
+			ctValidate(!this->has_ended(), status::cant_read) << "The stream ended before reading the desired data count" << ctValidateEnd;
+			ctStatusCall(this->fill_buffer());
+		}
+		else
+		{
+			// if a whole value could have been decoded from the buffer, the encoding is invalid
+			ctValidate( in_buffer < max_size, status::corrupted ) << "Invalid varint encoding at stream position " << this->current_position << ctValidateEnd;
+
+			// the next value straddles the end of the buffer, so read it a byte at a time
+			ctStatusCall(this->read_varint_bytewise( &dest[read_values] ));
+			++read_values;
+		}
+	}
+
+	// if we are at the end of the buffer, fill it with new data
+	if (this->buffer_position >= this->buffer_end)
+		ctStatusCall(this->fill_buffer());
+
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_varint_bytewise( _DataTy* dest )
+{
+	// read bytes until the last byte of the value, or the max size of the value is reached
+	u8 encoded[varint_max_size<_DataTy>::value];
+	size_t size = 0;
+	do
+	{
+		ctStatusCall(this->read_bytes( &encoded[size], 1 ));
+		++size;
+	} 
+	while( (encoded[size-1] & 0x80) != 0 && size < varint_max_size<_DataTy>::value );
+
+	ctValidate( varint_decode( encoded, size, dest ) == size, status::corrupted ) << "Invalid varint encoding at stream position " << this->current_position << ctValidateEnd;
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_bytes(u8* const dest, const size_t count)
 {
 	// if there are enough bytes left in the buffer, use these directly
 	if( this->buffer_end - this->buffer_position > count )
@@ -149,55 +466,411 @@ inline status read_stream<_DataSourceTy,_HashTy>::read_bytes(u8* const dest, con
 	return status::ok;
 }
 
-template<class _DataSourceTy, class _HashTy>
-inline bool read_stream<_DataSourceTy,_HashTy>::has_ended() const
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status_return<status, const u8*> read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_span(const size_t count)
+{
+	ctValidate( is_memory_mapped::value || count <= this->buffer_size, status::invalid_param ) << "The span of " << count << " bytes is larger than the stream buffer" << ctValidateEnd;
+
+	// in async_read mode, a span which straddles the two buffers is assembled in a separate span buffer
+	if( this->async_read && this->buffer_end - this->buffer_position < count )
+	{
+		this->span_buffer.resize(count);
+		ctStatusCall(this->read_bytes(this->span_buffer.data(), count));
+		return (const u8*)this->span_buffer.data();
+	}
+
+	// make sure the whole span is available, for mapped sources this may require multiple fills
+	while( this->buffer_end - this->buffer_position < count && !this->source_ended )
+		ctStatusCall(this->fill_buffer());
+	ctValidate( this->buffer_end - this->buffer_position >= count, status::cant_read ) << "The stream ended before reading the desired data count" << ctValidateEnd;
+
+	const u8* const span = &this->stream_data[this->buffer_position];
+	this->buffer_position += count;
+	this->current_position += count;
+	return span;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline bool read_stream<_DataSourceTy,_HashTy,_TransformTy>::has_ended() const
 {
-	// the definition of the end of the stream is that the buffer is not totally filled, since 
-	// no more bytes can be read, and that the buffer_position has come to the end of the partially filled buffer
-	if(this->buffer_end == this->buffer_size)
+	// the definition of the end of the stream is that the data source has ended, since no more 
+	// bytes can be read, and that the buffer_position has come to the end of the partially filled buffer
+	if( !this->source_ended )
 		return false;
 	return this->buffer_position >= this->buffer_end;
 }
 
-template<class _DataSourceTy, class _HashTy>
-inline void read_stream<_DataSourceTy,_HashTy>::read_from_buffer( u8* const dest, const size_t count )
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline void read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_from_buffer( u8* const dest, const size_t count )
 {
-	u8* const src = this->buffer.data();
-	memcpy(dest, &src[this->buffer_position], count);
+	memcpy(dest, &this->stream_data[this->buffer_position], count);
 	this->buffer_position += count;
 }
 
-template<class _DataSourceTy, class _HashTy>
-inline status read_stream<_DataSourceTy,_HashTy>::fill_buffer()
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::fill_buffer()
+{
+	// once the source has ended, there is nothing more to read, and the hash is already finished
+	if( this->source_ended )
+		return status::ok;
+	return this->fill_buffer( is_memory_mapped() );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::fill_buffer( std::true_type )
+{
+	// the whole source is already in memory, so step up the end of the readable window into the 
+	// mapped memory, and hash the new part of the window
+	const u64 source_size = std::min( this->data_source.size(), this->data_size );
+	const size_t fill_start = buffer_end;
+	const size_t fill_count = (size_t)std::min( (u64)this->buffer_size, source_size - buffer_end );
+	buffer_end += fill_count;
+
+	// update hash digest, if at the end of the stream, get the final hash value
+	this->source_ended = ( buffer_end == source_size );
+	ctStatusCall(this->hash_data(&this->stream_data[fill_start], fill_count, this->source_ended));
+
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::fill_buffer( std::false_type )
 {
-	u8* const buffer_data = this->buffer.data();
+	// if the next buffer is being prefetched, use it instead of reading into the current buffer
+	if( this->prefetch_pending )
+		return this->swap_buffers();
+
+	// the buffer is about to be modified, so any hashing of it must be done
+	ctStatusCall(this->wait_for_pending_hash());
+
+	u8* const buffer_data = this->buffer;
 	const size_t buffer_count = buffer_end - buffer_position;
 
 	// move whatever is left in the buffer to the beginning
 	if (buffer_count > 0)
-		memcpy( (void*)buffer_data, (void*)&buffer_data[buffer_position], buffer_count);
+		memmove( (void*)buffer_data, (void*)&buffer_data[buffer_position], buffer_count);
 	buffer_position = 0;
 	buffer_end = buffer_count;
 
 	// fill up with new data. 
 	const size_t fill_start = buffer_end;
-	const size_t fill_count = this->buffer.size() - buffer_end;
+	const size_t fill_count = this->buffer_size - buffer_end;
 	size_t read_count = 0;
-	ctStatusReturnCall(read_count, this->data_source.read(&buffer_data[fill_start], fill_count));
+	ctStatusReturnCall(read_count, this->read_source(&buffer_data[fill_start], fill_count));
 	buffer_end += read_count;
 
-	// update hash digest
-	this->hasher.update(&buffer_data[fill_start], read_count);
+	// update hash digest, if at the end of the stream, get the final hash value
+	this->source_ended = (read_count < fill_count);
+	ctStatusCall(this->hash_data(&buffer_data[fill_start], read_count, this->source_ended));
 
-	// if at the end of the stream, get the final hash value
-	if (read_count < fill_count)
-		ctStatusReturnCall( this->hash_digest , this->hasher.finish() );
+	// start reading the next buffer
+	if( !this->source_ended && this->async_read )
+		this->start_prefetch();
 	
 	return status::ok;
 }
 
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::swap_buffers()
+{
+	// the current buffer must be fully read before it can be swapped out
+	ctSanityCheck( this->buffer_position >= this->buffer_end );
+
+	// wait for the background read to finish, and make the back buffer the current buffer
+	this->prefetch_pending = false;
+	ctStatusCall(this->read_worker.wait());
+	const size_t read_count = (size_t)this->prefetch_count;
+	std::swap( this->buffer, this->back_buffer );
+	this->stream_data = this->buffer;
+	buffer_position = 0;
+	buffer_end = read_count;
+
+	// update hash digest, if at the end of the stream, get the final hash value. 
+	// (this also waits for any hashing of the back buffer, so that it can be reused)
+	this->source_ended = (read_count < this->buffer_size);
+	ctStatusCall(this->hash_data(this->stream_data, read_count, this->source_ended));
+
+	// start reading the next buffer
+	if( !this->source_ended )
+		this->start_prefetch();
+
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline void read_stream<_DataSourceTy,_HashTy,_TransformTy>::start_prefetch()
+{
+	u8* const dest = this->back_buffer;
+	const u64 count = this->buffer_size;
+	this->prefetch_pending = true;
+	this->read_worker.submit( [this,dest,count]() -> status
+	{
+		ctStatusReturnCall(this->prefetch_count, this->read_source(dest, count));
+		return status::ok;
+	} );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline void read_stream<_DataSourceTy,_HashTy,_TransformTy>::drop_prefetch()
+{
+	// wait for the background read to finish, and ignore its result
+	if( this->prefetch_pending )
+	{
+		this->read_worker.wait();
+		this->prefetch_pending = false;
+	}
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status_return<status, u64> read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_source( u8* dest, u64 count )
+{
+	return this->read_source( is_noop_transform(), dest, count );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status_return<status, u64> read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_source( std::true_type, u8* dest, u64 count )
+{
+	// dont read past the end of the stream data, into the block index footer
+	u64 read_count = 0;
+	ctStatusReturnCall(read_count, this->data_source.read(dest, std::min( count, this->data_size - this->source_position )));
+	this->source_position += read_count;
+	return read_count;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status_return<status, u64> read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_source( std::false_type, u8* dest, u64 count )
+{
+	// copy decoded data, and decode the next block when the current block is used up
+	u64 read_count = 0;
+	while( read_count < count )
+	{
+		if( this->decoded_position >= this->decoded_block.size() )
+		{
+			bool has_block = false;
+			ctStatusReturnCall(has_block, this->read_block());
+			if( !has_block )
+				break;
+		}
+
+		const size_t to_copy = (size_t)std::min<u64>( count - read_count, this->decoded_block.size() - this->decoded_position );
+		memcpy( &dest[read_count], &this->decoded_block[this->decoded_position], to_copy );
+		this->decoded_position += to_copy;
+		read_count += to_copy;
+	}
+	return read_count;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status_return<status, u64> read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_source_exact( u8* dest, u64 count )
+{
+	// read until count bytes are read, or the source ends
+	u64 read_count = 0;
+	while( read_count < count )
+	{
+		u64 block_count = 0;
+		ctStatusReturnCall(block_count, this->data_source.read(&dest[read_count], count - read_count));
+		if( block_count == 0 )
+			break;
+		read_count += block_count;
+	}
+	return read_count;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status_return<status, bool> read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_block()
+{
+	// read the block header, which holds the encoded and decoded sizes of the block (big-endian)
+	u8 header[8];
+	u64 header_count = 0;
+	ctStatusReturnCall(header_count, this->read_source_exact(header, sizeof(header)));
+	if( header_count == 0 )
+		return false;
+	ctValidate( header_count == sizeof(header), status::corrupted ) << "The block header is truncated" << ctValidateEnd;
+	const u32 encoded_size = from_bigendian<u32>( &header[0] );
+	const u32 decoded_size = from_bigendian<u32>( &header[4] );
+	ctValidate( decoded_size > 0 && encoded_size <= decoded_size, status::corrupted ) << "Invalid block header, encoded size: " << encoded_size << " decoded size: " << decoded_size << ctValidateEnd;
+
+	// the header is not trusted, so do not allocate more than the writer can produce
+	ctValidate( decoded_size <= max_block_size, status::corrupted ) << "Invalid block header, the decoded size " << decoded_size << " is larger than the max block size " << max_block_size << ctValidateEnd;
+
+	this->decoded_block.resize( decoded_size );
+	this->decoded_position = 0;
+
+	u64 read_count = 0;
+	if( encoded_size == decoded_size )
+	{
+		// the block is stored as is
+		ctStatusReturnCall(read_count, this->read_source_exact(this->decoded_block.data(), decoded_size));
+		ctValidate( read_count == decoded_size, status::corrupted ) << "The block is truncated" << ctValidateEnd;
+	}
+	else
+	{
+		this->encoded_block.resize( encoded_size );
+		ctStatusReturnCall(read_count, this->read_source_exact(this->encoded_block.data(), encoded_size));
+		ctValidate( read_count == encoded_size, status::corrupted ) << "The block is truncated" << ctValidateEnd;
+
+		size_t block_size = 0;
+		ctStatusReturnCall(block_size, this->transform.decode(this->encoded_block.data(), encoded_size, this->decoded_block.data(), decoded_size));
+		ctValidate( block_size == decoded_size, status::corrupted ) << "The decoded block size " << block_size << " does not match the block header size " << decoded_size << ctValidateEnd;
+	}
+
+	return true;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::hash_data( const u8* src, size_t count, bool last )
+{
+	// the hash is only valid if the whole stream is read in order
+	if( this->hashing_stopped )
+		return status::ok;
+
+	if( this->async_hash )
+	{
+		// wait for the previous hash, so only one filled buffer is hashed at a time, and hash the data on the hash worker thread
+		ctStatusCall(this->wait_for_pending_hash());
+		this->hash_worker.submit( [this,src,count]() { return this->hasher.update(src, count); } );
+		if( last )
+			ctStatusCall(this->wait_for_pending_hash());
+	}
+	else
+	{
+		ctStatusCall(this->hasher.update(src, count));
+	}
+
+	if( last )
+		ctStatusReturnCall( this->hash_digest , this->hasher.finish() );
+
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::wait_for_pending_hash()
+{
+	if( this->async_hash )
+		ctStatusCall( this->hash_worker.wait() );
+	return status::ok;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::seek( u64 position )
+{
+	ctValidate( is_noop_transform::value, status::invalid_param ) << "A transformed stream can not be seeked" << ctValidateEnd;
+	return this->seek( is_memory_mapped(), position );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::seek( std::true_type, u64 position )
+{
+	const u64 source_size = std::min( this->data_source.size(), this->data_size );
+	ctValidate( position <= source_size, status::invalid_param ) << "The seek position " << position << " is beyond the end of the stream data" << ctValidateEnd;
+
+	// within the part of the mapped memory which has already been hashed, just move the read position
+	this->current_position = position;
+	if( position <= this->buffer_end )
+	{
+		this->buffer_position = (size_t)position;
+		return status::ok;
+	}
+
+	// else restart the readable window at the new position, without hashing
+	ctStatusCall(this->wait_for_pending_hash());
+	this->hashing_stopped = true;
+	this->buffer_position = (size_t)position;
+	this->buffer_end = (size_t)position;
+	this->source_ended = false;
+	return this->fill_buffer();
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::seek( std::false_type, u64 position )
+{
+	ctValidate( position <= std::min( this->data_source.size(), this->data_size ), status::invalid_param ) << "The seek position " << position << " is beyond the end of the stream data" << ctValidateEnd;
+
+	// if the position is within the current buffer, just move the read position
+	const u64 buffer_start = this->current_position - this->buffer_position;
+	if( position >= buffer_start && position - buffer_start <= this->buffer_end )
+	{
+		this->buffer_position = (size_t)( position - buffer_start );
+		this->current_position = position;
+		return status::ok;
+	}
+
+	// drop any prefetched data, and refill the buffer from the new position, without hashing
+	this->drop_prefetch();
+	ctStatusCall(this->wait_for_pending_hash());
+	this->hashing_stopped = true;
+
+	ctStatusCall(this->data_source.seek(position));
+	this->source_position = position;
+	this->current_position = position;
+	this->buffer_position = 0;
+	this->buffer_end = 0;
+	this->source_ended = false;
+	return this->fill_buffer();
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::seek_record( size_t record_index )
+{
+	ctValidate( record_index < this->block_index.size(), status::invalid_param ) << "The record index " << record_index << " is out of range, the block index has " << this->block_index.size() << " records" << ctValidateEnd;
+	return this->seek( this->block_index[record_index] );
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_block_index( std::false_type )
+{
+	ctLogError << "The block index can only be read from a seekable data source" << ctLogEnd;
+	return status::invalid_param;
+}
+
+template<class _DataSourceTy, class _HashTy, class _TransformTy>
+inline status read_stream<_DataSourceTy,_HashTy,_TransformTy>::read_block_index( std::true_type )
+{
+	ctValidate( is_noop_transform::value, status::invalid_param ) << "A transformed stream can not have a block index" << ctValidateEnd;
+
+	// the footer is the record positions, followed by the record count and the block index id (all big-endian)
+	const u64 source_size = this->data_source.size();
+	const u64 footer_size = 2 * sizeof(u64);
+	ctValidate( source_size >= footer_size, status::corrupted ) << "The data source is too small to have a block index" << ctValidateEnd;
+
+	u8 footer[footer_size];
+	u64 read_count = 0;
+	ctStatusCall(this->data_source.seek(source_size - footer_size));
+	ctStatusReturnCall(read_count, this->read_source_exact(footer, footer_size));
+	ctValidate( read_count == footer_size, status::corrupted ) << "Could not read the block index footer" << ctValidateEnd;
+	const u64 record_count = from_bigendian<u64>( &footer[0] );
+	ctValidate( from_bigendian<u64>( &footer[8] ) == block_index_id, status::corrupted ) << "The data source does not end with a block index" << ctValidateEnd;
+	ctValidate( record_count <= ( source_size - footer_size ) / sizeof(u64), status::corrupted ) << "Invalid record count in the block index: " << record_count << ctValidateEnd;
+
+	// read the record positions, which must be in order, and within the stream data
+	const u64 index_size = record_count * sizeof(u64);
+	this->data_size = source_size - footer_size - index_size;
+	std::vector<u8> index_data( (size_t)index_size );
+	ctStatusCall(this->data_source.seek(this->data_size));
+	ctStatusReturnCall(read_count, this->read_source_exact(index_data.data(), index_size));
+	ctValidate( read_count == index_size, status::corrupted ) << "Could not read the block index" << ctValidateEnd;
+
+	this->block_index.resize( (size_t)record_count );
+	for( size_t inx = 0; inx < this->block_index.size(); ++inx )
+	{
+		this->block_index[inx] = from_bigendian<u64>( &index_data[inx * sizeof(u64)] );
+		ctValidate( this->block_index[inx] <= this->data_size && ( inx == 0 || this->block_index[inx - 1] <= this->block_index[inx] ), status::corrupted ) 
+			<< "Invalid record position in the block index: " << this->block_index[inx] << ctValidateEnd;
+	}
+
+	// rewind to the start of the stream data
+	ctStatusCall(this->data_source.seek(0));
+	return status::ok;
+}
+
 }
 // namespace ctle
 
 #include "_undef_macros.inl"
+
+inline ctle::read_stream_flags operator| ( const ctle::read_stream_flags &a, const ctle::read_stream_flags &b )
+{
+	return (ctle::read_stream_flags)( (int)a | (int)b );
+}
+
 #endif//_CTLE_READ_STREAM_H_
@@ -11,6 +11,7 @@
 #include <memory>
 #include <string>
 
+#include "fwd.h"
 #include "status.h"
 #include "status_return.h"
 
@@ -19,6 +20,8 @@ namespace ctle
 class socket;
 class stream_socket;
 class server_socket;
+class socket_data_source;
+class socket_data_destination;
 
 /// @brief The protocol family for the socket
 enum class socket_protocol_family
@@ -89,6 +92,63 @@ public:
 	status recv(void* buf, size_t buflen, size_t& received);
 };
 
+/// @brief Data source object for reading data from a connected stream socket. Used as a source for streaming data classes, e.g. read_stream
+/// to receive and hash a payload directly from a TCP connection.
+/// @details Partial receives are handled by the data source, so each read blocks until all requested bytes are received, the size 
+/// of the source is reached, or the peer closes the connection, which ends the source. A stream socket has no message boundaries, 
+/// so if the connection is used for more data after the payload, set the size of the source to the size of the payload.
+class socket_data_source
+{
+public:
+	/// @brief The size of a source which ends when the peer closes the connection
+	static constexpr u64 unlimited_size = ~u64(0);
+
+	/// @brief Create a data source which reads from the socket. The socket must stay valid for the lifetime of the data source.
+	/// @param _socket the connected socket
+	/// @param _source_size the number of bytes to read from the socket, or unlimited_size to read until the peer closes the connection
+	socket_data_source( stream_socket &_socket, u64 _source_size = unlimited_size ) : socket(_socket), source_size(_source_size) {}
+
+	/// @brief read from source into dest_buffer, return number of bytes actually read
+	/// 
+	/// @param dest_buffer the buffer to read into
+	/// @param read_count the number of bytes to read
+	/// @return status::ok, along with the number of bytes read, or an error status if the receive failed.
+	status_return<status, u64> read(u8* dest_buffer, u64 read_count);
+
+	/// @brief Get the number of bytes received from the socket
+	u64 get_position() const { return this->source_position; }
+
+private:
+	stream_socket &socket;
+	u64 source_size = unlimited_size;
+	u64 source_position = 0;
+	bool connection_closed = false;
+};
+
+/// @brief Data destination object for writing data to a connected stream socket. Used as a destination for streaming data classes, 
+/// e.g. write_stream to send and hash a payload directly over a TCP connection.
+/// @details Partial sends are handled by the data destination, so each write blocks until all bytes are sent, or an error occurs.
+class socket_data_destination
+{
+public:
+	/// @brief Create a data destination which writes to the socket. The socket must stay valid for the lifetime of the data destination.
+	socket_data_destination( stream_socket &_socket ) : socket(_socket) {}
+
+	/// @brief Write from source buffer to the socket.
+	/// 
+	/// @param src_buffer the buffer to write from
+	/// @param write_count the number of bytes to write
+	/// @return status::ok, along with the number of bytes written, or an error status if the send failed.
+	status_return<status, u64> write(const u8* src_buffer, u64 write_count);
+
+	/// @brief Get the number of bytes sent to the socket
+	u64 get_position() const { return this->destination_position; }
+
+private:
+	stream_socket &socket;
+	u64 destination_position = 0;
+};
+
 /// @brief A server socket for accepting incoming connections.
 class server_socket : public socket
 {
@@ -146,6 +206,7 @@ private:
 #include <atomic>
 #include <utility>
 #include <mutex>
+#include <algorithm>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -157,7 +218,7 @@ private:
 #if defined(_WIN32)
 #define _ADD_CTLE_HEADERS_WIN_STD
 #define _ADD_CTLE_HEADERS_WIN_SOCKETS
-#elif defined(linux)
+#elif defined(__linux__)
 #define _ADD_CTLE_HEADERS_LINUX_STD
 #define _ADD_CTLE_HEADERS_LINUX_SOCKETS
 #endif
@@ -238,7 +299,7 @@ status deinitialize_sockets()
 #if defined(_WIN32)
 using socket_type = SOCKET;
 constexpr const socket_type invalid_socket = socket_type(SOCKET_ERROR);
-#elif defined(linux)
+#elif defined(__linux__)
 using socket_type = int;
 constexpr const socket_type invalid_socket = -1;
 #endif
@@ -265,7 +326,7 @@ inline int get_last_socket_error()
 {
 #if defined(_WIN32)
 	return WSAGetLastError();
-#elif defined(linux)
+#elif defined(__linux__)
 	return errno;
 #endif
 }
@@ -314,7 +375,7 @@ inline status socket::file::close()
 	{
 #if defined(_WIN32)
 		int result = ::closesocket(this->fd);
-#elif defined(linux)
+#elif defined(__linux__)
 		int result = ::close(this->fd);
 #endif
 		this->fd = invalid_socket;
@@ -378,7 +439,7 @@ inline status socket::file::connect( const addrinfo &addr ) const
 
 #if defined(_WIN32)
 	result = ::connect(this->fd, addr.ai_addr, (int)addr.ai_addrlen);
-#elif defined(linux)
+#elif defined(__linux__)
 	result = ::connect(this->fd, addr.ai_addr, addr.ai_addrlen);
 #endif
 	ctValidate( result == 0 , status::cant_allocate ) 
@@ -401,7 +462,7 @@ inline status socket::file::bind( const addrinfo &addr, bool reuse_address ) con
 		const int option_value = 1;
 #if defined(_WIN32)
 		result = setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&option_value, sizeof(option_value));
-#elif defined(linux)
+#elif defined(__linux__)
 		result = setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &option_value, sizeof(option_value));
 #endif
 		ctValidate( result == 0 , status::cant_allocate ) 
@@ -412,7 +473,7 @@ inline status socket::file::bind( const addrinfo &addr, bool reuse_address ) con
 	// bind the socket
 #if defined(_WIN32)
 	result = ::bind(this->fd, addr.ai_addr, (int)addr.ai_addrlen);
-#elif defined(linux)
+#elif defined(__linux__)
 	result = ::bind(this->fd, addr.ai_addr, addr.ai_addrlen);
 #endif
 	ctValidate( result == 0 , status::cant_allocate ) 
@@ -456,8 +517,11 @@ inline status stream_socket::file::send(const void* buf, size_t buflen, size_t&
 
 #if defined(_WIN32)
 	int result = ::send(this->fd, (const char*)buf, (int)buflen, 0);
-#elif defined(linux)
-	ssize_t result = ::send(this->fd, buf, buflen, 0);
+#elif defined(__linux__)
+	// dont raise SIGPIPE if the peer has closed the connection, return the error instead. retry if interrupted by a signal
+	ssize_t result = ::send(this->fd, buf, buflen, MSG_NOSIGNAL);
+	while( result < 0 && errno == EINTR )
+		result = ::send(this->fd, buf, buflen, MSG_NOSIGNAL);
 #endif
 	if( result < 0 )
 	{
@@ -475,13 +539,16 @@ inline status stream_socket::file::recv(void* buf, size_t buflen, size_t& receiv
 
 #if defined(_WIN32)
 	int result = ::recv(this->fd, (char*)buf, (int)buflen, 0);
-#elif defined(linux)
+#elif defined(__linux__)
+	// retry if interrupted by a signal
 	ssize_t result = ::recv(this->fd, buf, buflen, 0);
+	while( result < 0 && errno == EINTR )
+		result = ::recv(this->fd, buf, buflen, 0);
 #endif
 	if( result < 0 )
 	{
 		received = 0;
-		return status::cant_write;
+		return status::cant_read;
 	}
 	received = result;
 	
@@ -593,6 +660,49 @@ status stream_socket::recv(void* buf, size_t buflen, size_t& received)
 
 /////////////////////////////////////////
 
+// the max number of bytes to send or receive in a single call (the length is an int on Windows)
+static const u64 socket_max_transfer_size = 1024 * 1024 * 1024;
+
+status_return<status, u64> socket_data_source::read(u8* dest_buffer, u64 read_count)
+{
+	// cap the read size to the size of the source
+	const u64 read_size = std::min( read_count, this->source_size - this->source_position );
+
+	// receive until all bytes are received, since recv may return fewer bytes than requested
+	u64 read_bytes = 0;
+	while( read_bytes < read_size && !this->connection_closed )
+	{
+		size_t received = 0;
+		ctStatusCall(this->socket.recv( &dest_buffer[read_bytes], (size_t)std::min( read_size - read_bytes, socket_max_transfer_size ), received ));
+
+		// if nothing was received, the peer has closed the connection
+		if( received == 0 )
+			this->connection_closed = true;
+		read_bytes += received;
+	}
+
+	this->source_position += read_bytes;
+	return read_bytes;
+}
+
+status_return<status, u64> socket_data_destination::write(const u8* src_buffer, u64 write_count)
+{
+	// send until all bytes are sent, since send may send fewer bytes than requested
+	u64 written_bytes = 0;
+	while( written_bytes < write_count )
+	{
+		size_t sent = 0;
+		ctStatusCall(this->socket.send( &src_buffer[written_bytes], (size_t)std::min( write_count - written_bytes, socket_max_transfer_size ), sent ));
+		ctValidate( sent > 0, status::cant_write ) << "The socket did not accept any data, " << written_bytes << " of " << write_count << " bytes were sent" << ctValidateEnd;
+		written_bytes += sent;
+	}
+
+	this->destination_position += written_bytes;
+	return written_bytes;
+}
+
+/////////////////////////////////////////
+
 struct server_socket::internal_data
 {
 	std::atomic<ctle::server_socket::server_state> _server_state = { server_state::stopped };
@@ -245,7 +245,7 @@ _CTLE_DEFINE_BITWISE_OPERATORS( ctle::quote_string_options )
 
 #if defined(_WIN32)
 #define _ADD_CTLE_HEADERS_WIN_STD
-#elif defined(linux)
+#elif defined(__linux__)
 #define _ADD_CTLE_HEADERS_LINUX_STD
 #endif
 #include "os.inl"
@@ -759,7 +759,7 @@ bool wstring_to_string( const std::wstring &srcStr, std::string &destStr )
 	return true;
 }
 
-#elif defined( __linux__ )
+#elif defined(__linux__)
 
 // keep a utf-8 locale around for conversions
 static class _utf_8_locale
@@ -841,7 +841,7 @@ bool wstring_to_string( const std::wstring &srcStr, std::string &destStr )
 	return true;
 }
 
-#endif// defined(_WIN32) elif defined(linux)
+#endif// defined(_WIN32) elif defined(__linux__)
 
 }
 // namespace ctle
@@ -0,0 +1,111 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+#pragma once
+#ifndef _CTLE_TASK_WORKER_H_
+#define _CTLE_TASK_WORKER_H_
+
+/// @file task_worker.h
+/// @brief Contains the task_worker class, a persistent worker thread which runs queued tasks in order.
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "status.h"
+
+namespace ctle
+{
+
+/// @brief A persistent worker thread, which runs queued tasks in the order they were submitted.
+/// @details The thread is started by the first call to submit(), and is kept running until the worker is destroyed, so
+/// a stream which hashes or writes each buffer on a worker does not create a new thread for each buffer. The status of
+/// the tasks is collected, and wait() returns the first error of the tasks which completed since the last call to wait().
+/// Tasks which are still queued when the worker is destroyed are run before the thread exits.
+class task_worker
+{
+public:
+	using task_type = std::function<status()>;
+
+	task_worker() {}
+	~task_worker()
+	{
+		if( this->thread.joinable() )
+		{
+			{
+				std::lock_guard<std::mutex> guard( this->mutex );
+				this->stopping = true;
+			}
+			this->task_added.notify_one();
+			this->thread.join();
+		}
+	}
+
+	task_worker( const task_worker & ) = delete;
+	task_worker &operator=( const task_worker & ) = delete;
+
+	/// @brief Queue a task, which is run on the worker thread after all previously submitted tasks
+	void submit( task_type task )
+	{
+		{
+			std::lock_guard<std::mutex> guard( this->mutex );
+			this->tasks.push_back( std::move( task ) );
+			if( !this->thread.joinable() )
+				this->thread = std::thread( [this]() { this->run(); } );
+		}
+		this->task_added.notify_one();
+	}
+
+	/// @brief Wait until all submitted tasks have completed
+	/// @return status::ok if all tasks succeeded, or the first error of the tasks since the last call to wait()
+	status wait()
+	{
+		std::unique_lock<std::mutex> lock( this->mutex );
+		this->tasks_done.wait( lock, [this]() { return this->tasks.empty() && !this->running_task; } );
+		status result = this->first_error;
+		this->first_error = status::ok;
+		return result;
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable task_added;
+	std::condition_variable tasks_done;
+	std::deque<task_type> tasks;
+	bool running_task = false;
+	bool stopping = false;
+	status first_error = status::ok;
+	std::thread thread;
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock( this->mutex );
+		for(;;)
+		{
+			this->task_added.wait( lock, [this]() { return !this->tasks.empty() || this->stopping; } );
+			if( this->tasks.empty() )
+				return;
+
+			task_type task = std::move( this->tasks.front() );
+			this->tasks.pop_front();
+			this->running_task = true;
+
+			// run the task without holding the lock, so more tasks can be submitted
+			lock.unlock();
+			const status result = task();
+			lock.lock();
+
+			if( !result && this->first_error )
+				this->first_error = result;
+			this->running_task = false;
+			if( this->tasks.empty() )
+				this->tasks_done.notify_all();
+		}
+	}
+};
+
+}
+//namespace ctle
+
+#endif//_CTLE_TASK_WORKER_H_
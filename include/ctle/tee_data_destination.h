@@ -0,0 +1,131 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+#pragma once
+#ifndef _CTLE_TEE_DATA_DESTINATION_H_
+#define _CTLE_TEE_DATA_DESTINATION_H_
+
+/// @file tee_data_destination.h
+/// @brief A data destination which writes the same data to multiple destinations in parallel, e.g. to replicate a write_stream to 
+/// two disks, or to a file and a socket.
+
+#include <tuple>
+#include <memory>
+#include <utility>
+
+#include "fwd.h"
+#include "status.h"
+#include "status_return.h"
+#include "task_worker.h"
+
+namespace ctle
+{
+
+/// @brief A data destination which fans out each write to a number of destinations.
+/// @details Each write is written to all destinations in parallel, and returns when all destinations are written. The first
+/// destination is written by the calling thread, and each of the other destinations by its own persistent worker thread (see
+/// task_worker). The destinations must stay valid for the lifetime of the tee destination. Combine with 
+/// write_stream_flags::async_write, so that the next buffer of the write_stream is filled while the destinations are written.
+/// @tparam _DataDestTys the types of the destinations, which all implement the write method of a data destination
+template<class... _DataDestTys>
+class tee_data_destination
+{
+public:
+	static_assert( sizeof...(_DataDestTys) > 0, "The tee destination needs at least one destination" );
+
+	/// @brief Create a tee destination which writes to all the destinations
+	tee_data_destination( _DataDestTys&... _destinations ) 
+		: destinations(_destinations...)
+		, workers( ( sizeof...(_DataDestTys) > 1 ) ? new task_worker[sizeof...(_DataDestTys) - 1] : nullptr ) 
+	{}
+
+	/// @brief Write from source buffer into all the destinations.
+	/// 
+	/// @param src_buffer the buffer to write from
+	/// @param write_count the number of bytes to write
+	/// @return status::ok, along with the number of bytes written, or the first error status of the destinations. 
+	status_return<status, u64> write(const u8* src_buffer, u64 write_count);
+
+	/// @brief Get the number of destinations
+	static constexpr size_t destination_count() { return sizeof...(_DataDestTys); }
+
+private:
+	std::tuple<_DataDestTys&...> destinations;
+
+	// the workers of the destinations after the first, which is written by the calling thread
+	std::unique_ptr<task_worker[]> workers;
+
+	template<size_t... _Inx> status write_destinations( std::index_sequence<_Inx...>, const u8* src_buffer, u64 write_count );
+	template<size_t _Inx> void start_write_destination( const u8* src_buffer, u64 write_count );
+	template<size_t _Inx> status write_destination( const u8* src_buffer, u64 write_count );
+};
+
+/// @brief Create a tee destination which writes to all the destinations, and deduce the types of the destinations.
+template<class... _DataDestTys> inline tee_data_destination<_DataDestTys...> make_tee_data_destination( _DataDestTys&... destinations )
+{
+	return tee_data_destination<_DataDestTys...>( destinations... );
+}
+
+}
+// namespace ctle
+
+#include "log.h"
+#include "_macros.inl"
+
+namespace ctle
+{
+
+template<class... _DataDestTys>
+inline status_return<status, u64> tee_data_destination<_DataDestTys...>::write(const u8* src_buffer, u64 write_count)
+{
+	if( write_count > 0 )
+	{
+		ctStatusCall(this->write_destinations( std::index_sequence_for<_DataDestTys...>(), src_buffer, write_count ));
+	}
+
+	return write_count;
+}
+
+template<class... _DataDestTys>
+template<size_t... _Inx>
+inline status tee_data_destination<_DataDestTys...>::write_destinations( std::index_sequence<_Inx...>, const u8* src_buffer, u64 write_count )
+{
+	// start the writes of the other destinations on their workers, and write the first destination on this thread
+	const int started[] = { ( this->template start_write_destination<_Inx>( src_buffer, write_count ), 0 )... };
+	(void)started;
+	status result = this->template write_destination<0>( src_buffer, write_count );
+
+	// wait for all the writes to finish, before the source buffer can be released, and report the first error
+	for( size_t inx = 0; inx + 1 < sizeof...(_DataDestTys); ++inx )
+	{
+		const status destination_status = this->workers[inx].wait();
+		if( !destination_status && result )
+			result = destination_status;
+	}
+	return result;
+}
+
+template<class... _DataDestTys>
+template<size_t _Inx>
+inline void tee_data_destination<_DataDestTys...>::start_write_destination( const u8* src_buffer, u64 write_count )
+{
+	if( _Inx == 0 )
+		return;
+	this->workers[_Inx - 1].submit( [this,src_buffer,write_count]() { return this->template write_destination<_Inx>(src_buffer, write_count); } );
+}
+
+template<class... _DataDestTys>
+template<size_t _Inx>
+inline status tee_data_destination<_DataDestTys...>::write_destination( const u8* src_buffer, u64 write_count )
+{
+	u64 written_count = 0;
+	ctStatusReturnCall(written_count, std::get<_Inx>(this->destinations).write(src_buffer, write_count));
+	ctValidate( written_count == write_count, status::cant_write ) << "Destination " << _Inx << " of the tee destination wrote " << written_count << " of " << write_count << " bytes" << ctValidateEnd;
+	return status::ok;
+}
+
+}
+// namespace ctle
+
+#include "_undef_macros.inl"
+
+#endif//_CTLE_TEE_DATA_DESTINATION_H_
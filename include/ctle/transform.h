@@ -0,0 +1,348 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+#pragma once
+#ifndef _CTLE_TRANSFORM_H_
+#define _CTLE_TRANSFORM_H_
+
+/// @file transform.h
+/// @brief Block transforms (compression codecs) for the transform stage of read_stream and write_stream.
+///
+/// The transform_[...] classes encode and decode blocks of data. The write_stream encodes each flushed buffer as a block,
+/// and the read_stream decodes the blocks back to the original data.
+///
+/// Each transform class implements the following functions:
+/// - ctor() to initialize the transform
+/// - max_encoded_size() to get the maximum size of an encoded block
+/// - encode() to encode a block of bytes
+/// - decode() to decode an encoded block of bytes
+/// @note transform_noop and transform_lz are always available. transform_zstd is implemented using an external library. The
+/// declaration exists, but to implement it, include zstd.h before including transform.h in the implementation source file, and
+/// link with zstd. (see the example implementation in the documentation for ctle.h for more information).
+
+#include <vector>
+
+#include "fwd.h"
+#include "status.h"
+#include "status_return.h"
+
+namespace ctle
+{
+
+/// @brief A no-operation transform, which is the default transform of the streams.
+/// @details The streams detect the noop transform (is_noop), and do not add any block headers to the stream, so the stream
+/// data is the same as the untransformed data.
+class transform_noop
+{
+public:
+	static constexpr bool is_noop = true;
+
+	/// @brief Get the maximum size of an encoded block
+	/// @param size the size of the source block in bytes
+	/// @return the maximum size of the encoded block in bytes
+	size_t max_encoded_size( size_t size ) const { return size; }
+
+	/// @brief Encode a block of bytes.
+	/// @param src the source data
+	/// @param src_size the size of the source data in bytes
+	/// @param dest the destination memory, with room for at least max_encoded_size(src_size) bytes
+	/// @param dest_capacity the size of the destination memory in bytes
+	/// @return status::ok and the size of the encoded block, or an error
+	status_return<status, size_t> encode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity );
+
+	/// @brief Decode an encoded block of bytes.
+	/// @param src the encoded data
+	/// @param src_size the size of the encoded data in bytes
+	/// @param dest the destination memory
+	/// @param dest_capacity the size of the destination memory in bytes, which is the size of the decoded block
+	/// @return status::ok and the size of the decoded block, or status::corrupted if the encoded data is invalid
+	status_return<status, size_t> decode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity );
+};
+
+/// @brief A fast LZ77 style compressor, which is implemented locally in ctle, and needs no external library.
+/// @details The codec uses a hash table of 4 byte sequences to find matches within the last 64KB of the block. The
+/// encoded block is a sequence of (literals, match) pairs, similar to the LZ4 block format.
+class transform_lz
+{
+public:
+	transform_lz();
+	~transform_lz();
+	static constexpr bool is_noop = false;
+
+	/// @copydoc transform_noop::max_encoded_size
+	size_t max_encoded_size( size_t size ) const { return size + ( size / 255 ) + 16; }
+
+	/// @copydoc transform_noop::encode
+	status_return<status, size_t> encode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity );
+
+	/// @copydoc transform_noop::decode
+	status_return<status, size_t> decode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity );
+
+private:
+	std::vector<u32> hash_table;
+};
+
+/// @brief A zstd compressor
+/// @note To use, include zstd in the build before transform.h to implement (see the example implementation in the documentation for ctle.h).
+class transform_zstd
+{
+public:
+	transform_zstd( int _compression_level = 3 );
+	~transform_zstd();
+	static constexpr bool is_noop = false;
+
+	/// @copydoc transform_noop::max_encoded_size
+	size_t max_encoded_size( size_t size ) const;
+
+	/// @copydoc transform_noop::encode
+	status_return<status, size_t> encode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity );
+
+	/// @copydoc transform_noop::decode
+	status_return<status, size_t> decode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity );
+
+private:
+	int compression_level = 3;
+	void *compress_context = nullptr;
+	void *decompress_context = nullptr;
+};
+
+}
+//namespace ctle
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef CTLE_IMPLEMENTATION
+
+#include <string.h>
+
+#include "log.h"
+#include "_macros.inl"
+
+namespace ctle
+{
+
+////////////////////////////////////////
+
+status_return<status, size_t> transform_noop::encode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity )
+{
+	ctValidate( src_size <= dest_capacity, status::invalid_param ) << "The destination is too small" << ctValidateEnd;
+	memcpy( dest, src, src_size );
+	return src_size;
+}
+
+status_return<status, size_t> transform_noop::decode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity )
+{
+	ctValidate( src_size <= dest_capacity, status::corrupted ) << "The decoded block is larger than the destination" << ctValidateEnd;
+	memcpy( dest, src, src_size );
+	return src_size;
+}
+
+////////////////////////////////////////
+
+static const size_t _transform_lz_hash_bits = 14;
+static const size_t _transform_lz_min_match = 4;
+static const size_t _transform_lz_max_offset = 0xffff;
+
+static inline u32 _transform_lz_read32( const u8* src )
+{
+	u32 value;
+	memcpy( &value, src, sizeof( value ) );
+	return value;
+}
+
+static inline u8* _transform_lz_write_length( u8* op, size_t length )
+{
+	// lengths of 15 or more are stored in the token as 15, followed by the rest of the length in bytes of 255, ending with a byte < 255
+	for( ; length >= 255; length -= 255 )
+		*op++ = 255;
+	*op++ = u8( length );
+	return op;
+}
+
+static inline u8* _transform_lz_write_sequence( u8* op, const u8* literals, size_t literal_count, size_t offset, size_t match_length )
+{
+	const size_t match_code = ( match_length > 0 ) ? ( match_length - _transform_lz_min_match ) : 0;
+	*op++ = u8( ( ( literal_count < 15 ) ? literal_count : 15 ) << 4 | ( ( match_code < 15 ) ? match_code : 15 ) );
+	if( literal_count >= 15 )
+		op = _transform_lz_write_length( op, literal_count - 15 );
+	memcpy( op, literals, literal_count );
+	op += literal_count;
+
+	// the last sequence of the block has no match
+	if( match_length > 0 )
+	{
+		*op++ = u8( offset & 0xff );
+		*op++ = u8( offset >> 8 );
+		if( match_code >= 15 )
+			op = _transform_lz_write_length( op, match_code - 15 );
+	}
+	return op;
+}
+
+transform_lz::transform_lz()
+{
+	this->hash_table.resize( size_t( 1 ) << _transform_lz_hash_bits );
+}
+
+transform_lz::~transform_lz()
+{
+}
+
+status_return<status, size_t> transform_lz::encode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity )
+{
+	ctValidate( dest_capacity >= this->max_encoded_size( src_size ), status::invalid_param ) << "The destination is too small" << ctValidateEnd;
+
+	// the hash table holds the position + 1 of the last occurence of each hashed 4 byte sequence (0 = no occurence)
+	u32* const table = this->hash_table.data();
+	memset( table, 0, this->hash_table.size() * sizeof( u32 ) );
+
+	size_t ip = 0;
+	size_t anchor = 0;
+	u8* op = dest;
+	while( ip + _transform_lz_min_match <= src_size )
+	{
+		const u32 sequence = _transform_lz_read32( &src[ip] );
+		const u32 hash = u32( sequence * 2654435761u ) >> ( 32 - _transform_lz_hash_bits );
+		const size_t candidate = table[hash];
+		table[hash] = u32( ip + 1 );
+
+		if( candidate == 0
+			|| ip - ( candidate - 1 ) > _transform_lz_max_offset
+			|| _transform_lz_read32( &src[candidate - 1] ) != sequence )
+		{
+			++ip;
+			continue;
+		}
+
+		// found a match, extend it as far as possible
+		const size_t match = candidate - 1;
+		size_t match_length = _transform_lz_min_match;
+		while( ip + match_length < src_size && src[match + match_length] == src[ip + match_length] )
+			++match_length;
+
+		op = _transform_lz_write_sequence( op, &src[anchor], ip - anchor, ip - match, match_length );
+		ip += match_length;
+		anchor = ip;
+	}
+
+	// write the remaining literals as the last sequence
+	op = _transform_lz_write_sequence( op, &src[anchor], src_size - anchor, 0, 0 );
+	return size_t( op - dest );
+}
+
+status_return<status, size_t> transform_lz::decode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity )
+{
+	size_t ip = 0;
+	size_t op = 0;
+	for(;;)
+	{
+		ctValidate( ip < src_size, status::corrupted ) << "The encoded block ended unexpectedly" << ctValidateEnd;
+		const u8 token = src[ip++];
+
+		// read the literal count, and copy the literals
+		size_t literal_count = token >> 4;
+		if( literal_count == 15 )
+		{
+			u8 b;
+			do
+			{
+				ctValidate( ip < src_size, status::corrupted ) << "The encoded block ended unexpectedly" << ctValidateEnd;
+				b = src[ip++];
+				literal_count += b;
+			}
+			while( b == 255 );
+		}
+		ctValidate( literal_count <= src_size - ip && literal_count <= dest_capacity - op, status::corrupted ) << "Invalid literal count in encoded block" << ctValidateEnd;
+		memcpy( &dest[op], &src[ip], literal_count );
+		ip += literal_count;
+		op += literal_count;
+
+		// the last sequence has no match
+		if( ip == src_size )
+			break;
+
+		// read the match, and copy it from the already decoded data
+		ctValidate( src_size - ip >= 2, status::corrupted ) << "The encoded block ended unexpectedly" << ctValidateEnd;
+		const size_t offset = size_t( src[ip] ) | ( size_t( src[ip + 1] ) << 8 );
+		ip += 2;
+		ctValidate( offset > 0 && offset <= op, status::corrupted ) << "Invalid match offset in encoded block" << ctValidateEnd;
+
+		size_t match_length = token & 0xf;
+		if( match_length == 15 )
+		{
+			u8 b;
+			do
+			{
+				ctValidate( ip < src_size, status::corrupted ) << "The encoded block ended unexpectedly" << ctValidateEnd;
+				b = src[ip++];
+				match_length += b;
+			}
+			while( b == 255 );
+		}
+		match_length += _transform_lz_min_match;
+		ctValidate( match_length <= dest_capacity - op, status::corrupted ) << "Invalid match length in encoded block" << ctValidateEnd;
+
+		// the match may overlap the output, in which case it has to be copied a byte at a time
+		const u8* match = &dest[op - offset];
+		if( offset >= match_length )
+		{
+			memcpy( &dest[op], match, match_length );
+		}
+		else
+		{
+			for( size_t inx = 0; inx < match_length; ++inx )
+				dest[op + inx] = match[inx];
+		}
+		op += match_length;
+	}
+
+	return op;
+}
+
+////////////////////////////////////////
+
+#ifdef ZSTD_H_235446
+
+transform_zstd::transform_zstd( int _compression_level )
+	: compression_level( _compression_level )
+{
+	this->compress_context = (void*)ZSTD_createCCtx();
+	this->decompress_context = (void*)ZSTD_createDCtx();
+}
+
+transform_zstd::~transform_zstd()
+{
+	ZSTD_freeCCtx( (ZSTD_CCtx*)this->compress_context );
+	ZSTD_freeDCtx( (ZSTD_DCtx*)this->decompress_context );
+}
+
+size_t transform_zstd::max_encoded_size( size_t size ) const
+{
+	return ZSTD_compressBound( size );
+}
+
+status_return<status, size_t> transform_zstd::encode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity )
+{
+	const size_t result = ZSTD_compressCCtx( (ZSTD_CCtx*)this->compress_context, dest, dest_capacity, src, src_size, this->compression_level );
+	ctValidate( !ZSTD_isError( result ), status::undefined_error ) << "zstd compression failed: " << ZSTD_getErrorName( result ) << ctValidateEnd;
+	return result;
+}
+
+status_return<status, size_t> transform_zstd::decode( const u8* src, size_t src_size, u8* dest, size_t dest_capacity )
+{
+	const size_t result = ZSTD_decompressDCtx( (ZSTD_DCtx*)this->decompress_context, dest, dest_capacity, src, src_size );
+	ctValidate( !ZSTD_isError( result ), status::corrupted ) << "zstd decompression failed: " << ZSTD_getErrorName( result ) << ctValidateEnd;
+	return result;
+}
+
+#endif//ZSTD_H_235446
+
+////////////////////////////////////////
+
+}
+//namespace ctle
+
+#include "_undef_macros.inl"
+
+#endif//CTLE_IMPLEMENTATION
+
+#endif//_CTLE_TRANSFORM_H_
@@ -0,0 +1,178 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+#pragma once
+#ifndef _CTLE_VARINT_H_
+#define _CTLE_VARINT_H_
+
+/// @file varint.h
+/// @brief Variable length (LEB128) encoding of integers, with zigzag encoding of signed integers.
+/// @details Each byte of an encoded value holds 7 bits of the value, lowest bits first, and the high bit of the byte is
+/// set if more bytes follow. Small values are encoded in fewer bytes, e.g. values below 128 are encoded in a single byte.
+/// Signed values are zigzag encoded before the LEB128 encoding (0, -1, 1, -2, 2, ... are encoded as 0, 1, 2, 3, 4, ...),
+/// so that small negative values are also encoded in few bytes.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <type_traits>
+
+namespace ctle
+{
+
+/// @brief The maximum number of bytes of an encoded value of integer type T.
+/// @tparam T The integer type.
+template <class T> struct varint_max_size
+{
+	static_assert( std::is_integral<T>::value, "T must be an integer type" );
+	static constexpr size_t value = ( sizeof( T ) * 8 + 6 ) / 7;
+};
+
+/// @brief Zigzag encodes a signed value, which maps signed values to unsigned values, so that values with a small magnitude
+/// are mapped to small values: 0, -1, 1, -2, 2, ... are mapped to 0, 1, 2, 3, 4, ...
+/// @tparam T The signed integer type.
+/// @param value The value to encode.
+/// @return The zigzag encoded value.
+template <class T> inline typename std::make_unsigned<T>::type zigzag_encode( T value )
+{
+	static_assert( std::is_signed<T>::value && std::is_integral<T>::value, "T must be a signed integer type" );
+	using unsigned_type = typename std::make_unsigned<T>::type;
+	return unsigned_type( unsigned_type( unsigned_type( value ) << 1 ) ^ unsigned_type( value >> ( sizeof( T ) * 8 - 1 ) ) );
+}
+
+/// @brief Decodes a zigzag encoded value.
+/// @tparam T The unsigned integer type of the encoded value.
+/// @param value The zigzag encoded value.
+/// @return The decoded signed value.
+template <class T> inline typename std::make_signed<T>::type zigzag_decode( T value )
+{
+	static_assert( std::is_unsigned<T>::value, "T must be an unsigned integer type" );
+	using signed_type = typename std::make_signed<T>::type;
+	return signed_type( T( value >> 1 ) ^ T( T( 0 ) - T( value & 1 ) ) );
+}
+
+// converts values to and from the unsigned value which is LEB128 encoded (signed values are zigzag encoded)
+template <class T> inline typename std::make_unsigned<T>::type _varint_to_unsigned( T value, std::true_type ) { return zigzag_encode( value ); }
+template <class T> inline T _varint_to_unsigned( T value, std::false_type ) { return value; }
+template <class T> inline typename std::make_unsigned<T>::type _varint_to_unsigned( T value ) { return _varint_to_unsigned( value, std::is_signed<T>() ); }
+template <class T> inline T _varint_from_unsigned( typename std::make_unsigned<T>::type value, std::true_type ) { return zigzag_decode( value ); }
+template <class T> inline T _varint_from_unsigned( T value, std::false_type ) { return value; }
+template <class T> inline T _varint_from_unsigned( typename std::make_unsigned<T>::type value ) { return _varint_from_unsigned<T>( value, std::is_signed<T>() ); }
+
+/// @brief Encodes an integer value as a varint. Signed values are zigzag encoded.
+/// @tparam T The integer type.
+/// @param dest The destination memory, which must have room for at least varint_max_size<T>::value bytes.
+/// @param value The value to encode.
+/// @return The number of bytes written to dest.
+template <class T> inline size_t varint_encode( uint8_t *dest, T value )
+{
+	static_assert( std::is_integral<T>::value, "T must be an integer type" );
+	auto v = _varint_to_unsigned( value );
+	size_t size = 0;
+	while( v >= 0x80 )
+	{
+		dest[size++] = uint8_t( v | 0x80 );
+		v = decltype( v )( v >> 7 );
+	}
+	dest[size++] = uint8_t( v );
+	return size;
+}
+
+/// @brief Encodes an array of integer values as varints. Signed values are zigzag encoded.
+/// @tparam T The integer type.
+/// @param dest The destination memory, which must have room for at least count * varint_max_size<T>::value bytes.
+/// @param values The values to encode.
+/// @param count The number of values to encode.
+/// @return The number of bytes written to dest.
+template <class T> inline size_t varint_encode( uint8_t *dest, const T *values, size_t count )
+{
+	size_t size = 0;
+	for( size_t i = 0; i < count; ++i )
+		size += varint_encode( &dest[size], values[i] );
+	return size;
+}
+
+/// @brief Decodes a single varint encoded integer value.
+/// @tparam T The integer type.
+/// @param src The encoded data.
+/// @param src_size The number of bytes available in src.
+/// @param value Receives the decoded value.
+/// @return The number of bytes read from src, or 0 if the value is not complete within src_size bytes, or if the encoding
+/// is invalid for type T (the value is out of range, or longer than varint_max_size<T>::value bytes). If src_size is at least
+/// varint_max_size<T>::value and 0 is returned, the encoding is invalid.
+template <class T> inline size_t varint_decode( const uint8_t *src, size_t src_size, T *value )
+{
+	static_assert( std::is_integral<T>::value, "T must be an integer type" );
+	using unsigned_type = typename std::make_unsigned<T>::type;
+	const size_t max_size = varint_max_size<T>::value;
+	const size_t last_byte_bits = sizeof( T ) * 8 - 7 * ( max_size - 1 );
+
+	unsigned_type v = 0;
+	const size_t size = ( src_size < max_size ) ? src_size : max_size;
+	for( size_t i = 0; i < size; ++i )
+	{
+		const uint8_t b = src[i];
+
+		// the last byte can only hold the remaining bits of the value, and can not be followed by more bytes
+		if( i == max_size - 1 && ( b >> last_byte_bits ) != 0 )
+			return 0;
+
+		v = unsigned_type( v | unsigned_type( unsigned_type( b & 0x7f ) << ( 7 * i ) ) );
+		if( ( b & 0x80 ) == 0 )
+		{
+			*value = _varint_from_unsigned<T>( v );
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+/// @brief Decodes an array of varint encoded integer values.
+/// @details Decodes values until count values are decoded, or the next value is not complete within the source data,
+/// or the encoding of the next value is invalid. Runs of 8 single byte values (which are common for small values, such as
+/// counts and indices) are detected with a single 64 bit test, and decoded without checking each byte.
+/// @tparam T The integer type.
+/// @param src The encoded data.
+/// @param src_size The number of bytes available in src.
+/// @param values Destination of the decoded values, with room for count values.
+/// @param count The number of values to decode.
+/// @param decoded_count Receives the number of values which were decoded.
+/// @return The number of bytes read from src.
+template <class T> inline size_t varint_decode( const uint8_t *src, size_t src_size, T *values, size_t count, size_t *decoded_count )
+{
+	using unsigned_type = typename std::make_unsigned<T>::type;
+
+	size_t pos = 0;
+	size_t n = 0;
+	while( n < count )
+	{
+		// fast path, check if the next 8 bytes are all single byte values
+		if( count - n >= 8 && src_size - pos >= 8 )
+		{
+			uint64_t word;
+			memcpy( &word, &src[pos], sizeof( word ) );
+			if( ( word & 0x8080808080808080ull ) == 0 )
+			{
+				for( size_t i = 0; i < 8; ++i )
+					values[n + i] = _varint_from_unsigned<T>( unsigned_type( src[pos + i] ) );
+				pos += 8;
+				n += 8;
+				continue;
+			}
+		}
+
+		const size_t size = varint_decode( &src[pos], src_size - pos, &values[n] );
+		if( size == 0 )
+			break;
+		pos += size;
+		++n;
+	}
+
+	*decoded_count = n;
+	return pos;
+}
+
+}
+//namespace ctle
+
+#endif//_CTLE_VARINT_H_
@@ -5,32 +5,81 @@
 #define _CTLE_WRITE_STREAM_H_
 
 #include <vector>
+#include <memory>
 
 #include "fwd.h"
 #include "status.h"
 #include "status_return.h"
 #include "hasher.h"
+#include "transform.h"
 #include "file_funcs.h"
+#include "endianness.h"
+#include "varint.h"
+#include "task_worker.h"
 
 namespace ctle
 {
+// Checks if a data destination can write multiple memory spans in a single call, in which case write_stream::write_gather writes
+// the stream buffer and the spans with one call to the destination. A gather destination implements a 
+// write_gather(const write_span* spans, size_t span_count) method, which returns the number of bytes written. (See file_data_destination)
+template<class _DataDestTy, class = void> struct is_gather_data_destination : std::false_type {};
+template<class _DataDestTy> struct is_gather_data_destination<_DataDestTy, decltype( (void)std::declval<_DataDestTy&>().write_gather( (const write_span*)nullptr, size_t() ) )> : std::true_type {};
+
+// flags for setting up a write_stream
+enum class write_stream_flags : int
+{
+	async_write = 0x1,	// hash and write full buffers to the destination on a background thread, while the next buffer is being filled
+	async_hash = 0x2,	// hash the data on a worker thread, while it is being written to the destination
+	block_index = 0x4,	// write a block index footer with the positions of the records marked with mark_record(), when the stream ends
+};
+
 // base class for a write_stream, a read-only input stream which is designed for 
 // streaming data sequentially, using a memory buffer, while also calculating a hash on the input stream.
-template<class _DataDestTy, class _HashTy /* = hasher_noop<64> */>
+// With the write_stream_flags::async_write flag, the stream uses two buffers, and full buffers are hashed and written to 
+// the destination on a persistent worker thread (write-behind), while the next buffer is filled. Any error from the background
+// write is returned from the next call which flushes the buffer, or from end().
+// With the write_stream_flags::async_hash flag, the data is hashed on a persistent worker thread while it is written to the destination, 
+// so hashing and writing run concurrently. (Combined with async_write, filling the next buffer also runs concurrently.)
+// The buffer size can be set in the constructor, and the caller can also supply the buffer memory to use, so that 
+// many short-lived streams can reuse the same memory.
+// The _TransformTy transform stage encodes each flushed buffer as a block (e.g. transform_lz to compress the data), which 
+// is written with a header of the encoded and decoded sizes. Blocks which do not get smaller are stored as is. The hash is 
+// calculated on the data before it is transformed. The default transform_noop writes the data as is, without block headers.
+// With the write_stream_flags::block_index flag, the stream positions of records marked with mark_record() are written in 
+// a block index footer by end(), so that a read_stream can seek directly to any record, without reading the whole stream.
+template<class _DataDestTy, class _HashTy /* = hasher_noop<64> */, class _TransformTy /* = transform_noop */>
 class write_stream
 {
-	const size_t buffer_size = 2 * 1024 * 1024;
-
 public:
-	write_stream( _DataDestTy &_data_dest );
+	// the default size of the stream buffer
+	static constexpr size_t default_buffer_size = 2 * 1024 * 1024;
+
+	// the id which ends a block index footer (matches read_stream::block_index_id)
+	static constexpr u64 block_index_id = 0x63746c65696e6478; // "ctleindx"
+
+	// the max decoded size of a transformed block, larger buffers are written as multiple blocks (matches read_stream::max_block_size)
+	static constexpr size_t max_block_size = 64 * 1024 * 1024;
+
+	// Create a write stream which allocates its own buffer. In async_write mode, two buffers of _buffer_size are allocated.
+	// The buffer is aligned to _file_object::unbuffered_alignment, for unbuffered file destinations.
+	write_stream( _DataDestTy &_data_dest, write_stream_flags flags = {}, size_t _buffer_size = default_buffer_size );
+
+	// Create a write stream which uses buffer memory supplied by the caller. The memory must stay valid for the lifetime of the stream.
+	// In async_write mode, the memory is split into two buffers.
+	write_stream( _DataDestTy &_data_dest, u8* external_buffer, size_t external_buffer_size, write_stream_flags flags = {} );
+
 	~write_stream();
 
 	using data_destination_type = _DataDestTy;
 	using hasher_type = _HashTy;
 	using hash_type = typename _HashTy::hash_type;
+	using transform_type = _TransformTy;
 
 	// Get the current position/number of bytes written to the stream (not the actual bytes written to the destination, which may be less because of cacheing)
 	u64 get_position() const { return this->current_position; };
+
+	// Get the size of the stream buffer
+	size_t get_buffer_size() const { return this->buffer_size; }
 	
 	// Writes a single value to the stream. (Note that for writing multiple values, the write method which takes a pointer and a count is much more efficient.)
 	// Caveat! The type must be trivially copyable, memcpy is used since the dest cache data values may not be correctly aligned
@@ -42,10 +91,36 @@ public:
 	// Caveat! Make sure the type is correctly packed, since any alignment byte will also be written to the stream
 	template<class _DataTy> status write(const _DataTy* src, size_t count = 1);
 
+	// Write a number of values to the stream in big-endian byte order, converting from the native byte order of the host. 
+	// On little-endian hosts, the byte order is swapped while the values are copied into the stream buffer, so the data is only 
+	// touched once. On big-endian hosts, the values are copied as is. (see copy_bigendian)
+	// Caveat! The type must be trivially copyable, and have a size of 1, 2, 4 or 8 bytes (see byte_order_swap_type)
+	template<class _DataTy> status write_bigendian(const _DataTy* src, size_t count = 1);
+
+	// Write a single integer value to the stream as a varint (LEB128). Signed values are zigzag encoded. (See varint.h)
+	template<class _DataTy> status write_varint(const _DataTy& src);
+
+	// Write a number of integer values to the stream as varints (LEB128). Signed values are zigzag encoded. (See varint.h)
+	// Small values are encoded in fewer bytes, e.g. values below 128 (or between -64 and 63 for signed values) are encoded in a single byte.
+	template<class _DataTy> status write_varint(const _DataTy* src, size_t count = 1);
+
 	// Write raw bytes to the stream 
 	status write_bytes( const u8* src, size_t count);
 
-	// Ends the stream, flushes the destination, and calculates the final hash. 
+	// Write a number of memory spans to the stream, in order. If all spans fit in the buffer, they are copied into the buffer with a 
+	// single capacity check. Else, if the destination supports gather writes (see is_gather_data_destination), the buffered data 
+	// and the spans are written with a single call to the destination, bypassing the buffer. 
+	status write_gather( const write_span* spans, size_t span_count );
+
+	// Marks the current position of the stream as the start of a record in the block index. Requires the write_stream_flags::block_index 
+	// flag, and a stream without a transform, since the positions in the index are positions in the destination.
+	status mark_record();
+
+	// Get the number of records which have been marked in the block index
+	size_t get_record_count() const { return this->block_index.size(); }
+
+	// Ends the stream, flushes the destination, waits for any background write, writes the block index footer (if enabled) 
+	// and calculates the final hash. Calling end() on a stream which has already ended is a noop.
 	status end();
 
 	// Get the hash digest from the stream. Note that the hash value will be 
@@ -55,15 +130,47 @@ public:
 private:
 	u64 current_position = 0;
 	size_t buffer_position = 0;
-	std::vector<u8> buffer;
+	bool async_write = false;
+	bool async_hash = false;
+	bool has_ended = false;
+	bool write_block_index = false;
+	size_t buffer_size = 0;
+	u8* buffer = nullptr;
+	u8* back_buffer = nullptr;
+	std::unique_ptr<u8[]> allocated_buffer;
 
 	data_destination_type &data_dest;
 	hasher_type hasher;
 	hash_type hash_digest;
 
+	// the transform, and the memory of the encoded block
+	transform_type transform;
+	std::vector<u8> encoded_block;
+
+	// the stream positions of the marked records, in block_index mode
+	std::vector<u64> block_index;
+
+	// the spans of a gather write, including the buffered data
+	std::vector<write_span> gather_spans;
+
+	// the worker which hashes the data while it is written, in async_hash mode
+	task_worker hash_worker;
+
+	// the worker which writes the back buffer, in async_write mode. (declared after the hash worker, so 
+	// it is stopped first, since the writes use the hash worker)
+	task_worker write_worker;
+
+	void setup( write_stream_flags flags, u8* external_buffer, size_t _buffer_size );
 	void write_to_buffer( const u8 *src, size_t count );
 	status write_to_destination( const u8 *src, size_t count );
+	status write_blocks( std::true_type, const u8 *src, size_t count );
+	status write_blocks( std::false_type, const u8 *src, size_t count );
+	status write_raw( const u8 *src, size_t count );
 	status flush_buffer();
+	status wait_for_pending_write();
+	status write_block_index_footer();
+	status write_gather_to_destination( std::true_type, const write_span* spans, size_t span_count );
+	status write_gather_to_destination( std::false_type, const write_span* spans, size_t span_count );
 };
 
 }
@@ -74,29 +181,63 @@ private:
 namespace ctle
 {
 
-template<class _DataDestTy, class _HashTy>
-inline write_stream<_DataDestTy,_HashTy>::write_stream( _DataDestTy &_data_dest ) 
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline write_stream<_DataDestTy,_HashTy,_TransformTy>::write_stream( _DataDestTy &_data_dest, write_stream_flags flags, size_t _buffer_size ) 
 	: data_dest(_data_dest)
 {
-	this->buffer.resize(buffer_size);
+	this->setup( flags, nullptr, _buffer_size );
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline write_stream<_DataDestTy,_HashTy,_TransformTy>::write_stream( _DataDestTy &_data_dest, u8* external_buffer, size_t external_buffer_size, write_stream_flags flags ) 
+	: data_dest(_data_dest)
+{
+	ctValidate( external_buffer != nullptr, status::invalid_param ) << "The external buffer must be a valid memory area" << ctValidateThrow;
+	this->setup( flags, external_buffer, external_buffer_size );
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline void write_stream<_DataDestTy,_HashTy,_TransformTy>::setup( write_stream_flags flags, u8* external_buffer, size_t _buffer_size )
+{
+	this->async_write = ( (int)flags & (int)write_stream_flags::async_write );
+	this->async_hash = ( (int)flags & (int)write_stream_flags::async_hash );
+	this->write_block_index = ( (int)flags & (int)write_stream_flags::block_index );
+	ctValidate( !this->write_block_index || _TransformTy::is_noop, status::invalid_param ) << "A transformed stream can not have a block index" << ctValidateThrow;
+
+	// in async_write mode, external buffer memory is split into two buffers
+	this->buffer_size = ( external_buffer && this->async_write ) ? ( _buffer_size / 2 ) : ( _buffer_size );
+	ctValidate( this->buffer_size > 0, status::invalid_param ) << "The buffer size of the stream can not be 0" << ctValidateThrow;
+
+	// allocate the buffer(s) if not supplied by the caller
+	if( !external_buffer )
+	{
+		// the buffer is aligned for unbuffered file writes (see _file_object::open_write)
+		const size_t alignment = _file_object::unbuffered_alignment;
+		this->allocated_buffer.reset( new u8[ ( ( this->async_write ) ? ( this->buffer_size * 2 ) : ( this->buffer_size ) ) + alignment - 1 ] );
+		external_buffer = (u8*)( ( (uintptr_t)this->allocated_buffer.get() + alignment - 1 ) & ~(uintptr_t)( alignment - 1 ) );
+	}
+
+	this->buffer = external_buffer;
+	if( this->async_write )
+		this->back_buffer = &external_buffer[this->buffer_size];
 }
 
-template<class _DataDestTy, class _HashTy>
-inline write_stream<_DataDestTy,_HashTy>::~write_stream()
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline write_stream<_DataDestTy,_HashTy,_TransformTy>::~write_stream()
 {
 	this->end();
 }
 
-template<class _DataDestTy, class _HashTy>
+template<class _DataDestTy, class _HashTy, class _TransformTy>
 template<class _DataTy>
-inline status write_stream<_DataDestTy,_HashTy>::write( const _DataTy& src )
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write( const _DataTy& src )
 {
 	return this->write( &src, 1);
 }
 
-template<class _DataDestTy, class _HashTy>
+template<class _DataDestTy, class _HashTy, class _TransformTy>
 template<class _DataTy>
-inline status write_stream<_DataDestTy,_HashTy>::write( const _DataTy* src, size_t count)
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write( const _DataTy* src, size_t count)
 {
 	static_assert( std::is_trivially_copyable<_DataTy>(), "_DataTy data type must be trivially copyable" );
 
@@ -104,8 +245,91 @@ inline status write_stream<_DataDestTy,_HashTy>::write( const _DataTy* src, size
 	return status::ok;
 }
 
-template<class _DataDestTy, class _HashTy>
-inline status write_stream<_DataDestTy,_HashTy>::write_bytes(const u8* src, size_t count)
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_bigendian( const _DataTy* src, size_t count)
+{
+	static_assert( std::is_trivially_copyable<_DataTy>(), "_DataTy data type must be trivially copyable" );
+	using swap_type = typename byte_order_swap_type<sizeof(_DataTy)>::type;
+
+	size_t written_values = 0;
+	while( written_values < count )
+	{
+		const size_t buffer_space = (this->buffer_size - this->buffer_position) / sizeof(_DataTy);
+		const size_t to_write = std::min(count - written_values, buffer_space);
+		if( to_write > 0 )
+		{
+			// copy and convert as many values as fits in the buffer
+			copy_bigendian<swap_type>( &this->buffer[this->buffer_position], &src[written_values], to_write );
+			this->buffer_position += to_write * sizeof(_DataTy);
+			this->current_position += to_write * sizeof(_DataTy);
+			written_values += to_write;
+		}
+		else if( this->buffer_position > 0 )
+		{
+			// the buffer is full, flush it to the destination
+			ctStatusCall(this->flush_buffer());
+		}
+		else
+		{
+			// the buffer is smaller than a single value, convert the value to a temporary and write it with write_bytes
+			_DataTy value;
+			copy_bigendian<swap_type>( &value, &src[written_values], 1 );
+			ctStatusCall(this->write_bytes( (const u8*)&value, sizeof(_DataTy) ));
+			++written_values;
+		}
+	}
+
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_varint( const _DataTy& src )
+{
+	return this->write_varint( &src, 1 );
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+template<class _DataTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_varint( const _DataTy* src, size_t count )
+{
+	static_assert( std::is_integral<_DataTy>(), "_DataTy data type must be an integer type" );
+	const size_t max_size = varint_max_size<_DataTy>::value;
+
+	size_t written_values = 0;
+	while( written_values < count )
+	{
+		// the number of values which are guaranteed to fit in the buffer
+		const size_t buffer_space = (this->buffer_size - this->buffer_position) / max_size;
+		const size_t to_write = std::min(count - written_values, buffer_space);
+		if( to_write > 0 )
+		{
+			const size_t encoded_size = varint_encode( &this->buffer[this->buffer_position], &src[written_values], to_write );
+			this->buffer_position += encoded_size;
+			this->current_position += encoded_size;
+			written_values += to_write;
+		}
+		else if( this->buffer_position > 0 )
+		{
+			// the buffer is full, flush it to the destination
+			ctStatusCall(this->flush_buffer());
+		}
+		else
+		{
+			// the buffer is smaller than the max size of a value, encode the value to a temporary and write it with write_bytes
+			u8 encoded[max_size];
+			const size_t encoded_size = varint_encode( encoded, src[written_values] );
+			ctStatusCall(this->write_bytes( encoded, encoded_size ));
+			++written_values;
+		}
+	}
+
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_bytes(const u8* src, size_t count)
 {
 	// if the write fits in the buffer, use the buffer
 	if( (buffer_size - this->buffer_position) > count )
@@ -124,6 +348,8 @@ inline status write_stream<_DataDestTy,_HashTy>::write_bytes(const u8* src, size
 		}
 		else
 		{
+			// make sure any previous buffer is written before the data, to keep the order of the stream
+			ctStatusCall(this->wait_for_pending_write());
 			ctStatusCall(this->write_to_destination(src,count));
 		}
 	}
@@ -132,44 +358,239 @@ inline status write_stream<_DataDestTy,_HashTy>::write_bytes(const u8* src, size
 	return status::ok;
 }
 
-template<class _DataDestTy, class _HashTy>
-inline status write_stream<_DataDestTy,_HashTy>::end()
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_gather( const write_span* spans, size_t span_count )
+{
+	size_t total_count = 0;
+	for( size_t inx = 0; inx < span_count; ++inx )
+		total_count += spans[inx].size;
+
+	// if all spans fit in the buffer, copy them in one go
+	if( (buffer_size - this->buffer_position) > total_count )
+	{
+		for( size_t inx = 0; inx < span_count; ++inx )
+			this->write_to_buffer( (const u8*)spans[inx].data, spans[inx].size );
+		this->current_position += total_count;
+		return status::ok;
+	}
+
+	// else write the buffered data and the spans directly to a gather destination, (a transform needs the data in one block, 
+	// so transformed streams write the spans one by one through the buffer)
+	using gather_write = std::integral_constant<bool, is_gather_data_destination<_DataDestTy>::value && _TransformTy::is_noop>;
+	return this->write_gather_to_destination( gather_write(), spans, span_count );
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_gather_to_destination( std::false_type, const write_span* spans, size_t span_count )
+{
+	for( size_t inx = 0; inx < span_count; ++inx )
+		ctStatusCall(this->write_bytes( (const u8*)spans[inx].data, spans[inx].size ));
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_gather_to_destination( std::true_type, const write_span* spans, size_t span_count )
 {
+	// make sure any previous buffer is written before the data, to keep the order of the stream
+	ctStatusCall(this->wait_for_pending_write());
+
+	// the buffered data goes first, followed by the spans
+	this->gather_spans.clear();
+	if( this->buffer_position > 0 )
+		this->gather_spans.push_back( { this->buffer, this->buffer_position } );
+	this->gather_spans.insert( this->gather_spans.end(), spans, spans + span_count );
+
+	u64 total_count = 0;
+	for( const auto &span : this->gather_spans )
+		total_count += span.size;
+
+	// hash the spans in order, on a worker thread in async_hash mode while the spans are written
+	auto hash_spans = [this]() -> status
+	{
+		for( const auto &span : this->gather_spans )
+			ctStatusCall(this->hasher.update( (const u8*)span.data, span.size ));
+		return status::ok;
+	};
+	auto write_spans = [this,total_count]() -> status
+	{
+		u64 written_count = 0;
+		ctStatusReturnCall(written_count, this->data_dest.write_gather(this->gather_spans.data(), this->gather_spans.size()));
+		ctValidate( written_count == total_count, status::cant_write ) << "The write operation failed. " << written_count << " of " << total_count << " bytes were written." << ctValidateEnd;
+		return status::ok;
+	};
+	if( this->async_hash )
+	{
+		// the spans must stay valid until the hashing is done, so always wait for the hash, also if the write fails
+		this->hash_worker.submit( hash_spans );
+		const status write_result = write_spans();
+		ctStatusCall(this->hash_worker.wait());
+		ctStatusCall(write_result);
+	}
+	else
+	{
+		ctStatusCall(hash_spans());
+		ctStatusCall(write_spans());
+	}
+
+	this->current_position += total_count - this->buffer_position;
+	this->buffer_position = 0;
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::end()
+{
+	if( this->has_ended )
+		return status::ok;
+
 	ctStatusCall(this->flush_buffer());
+	ctStatusCall(this->wait_for_pending_write());
+	if( this->write_block_index )
+		ctStatusCall(this->write_block_index_footer());
 	ctStatusReturnCall( this->hash_digest , this->hasher.finish() );
+	this->has_ended = true;
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::mark_record()
+{
+	ctValidate( this->write_block_index, status::invalid_param ) << "The stream was not set up with the write_stream_flags::block_index flag" << ctValidateEnd;
+	this->block_index.push_back( this->current_position );
 	return status::ok;
 }
 
-template<class _DataDestTy, class _HashTy>
-inline void write_stream<_DataDestTy,_HashTy>::write_to_buffer( const u8 *src, size_t count )
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_block_index_footer()
 {
-	u8* const dest = this->buffer.data();
+	// the footer is the record positions, followed by the record count and the block index id (all big-endian).
+	// the footer is not part of the stream data, so it is not hashed
+	std::vector<u8> footer( ( this->block_index.size() + 2 ) * sizeof(u64) );
+	for( size_t inx = 0; inx < this->block_index.size(); ++inx )
+		to_bigendian<u64>( &footer[inx * sizeof(u64)], this->block_index[inx] );
+	to_bigendian<u64>( &footer[footer.size() - 16], (u64)this->block_index.size() );
+	to_bigendian<u64>( &footer[footer.size() - 8], block_index_id );
+	return this->write_raw( footer.data(), footer.size() );
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline void write_stream<_DataDestTy,_HashTy,_TransformTy>::write_to_buffer( const u8 *src, size_t count )
+{
+	u8* const dest = this->buffer;
 	memcpy(&dest[this->buffer_position], src, count);
 	this->buffer_position += count;
 }
 
-template<class _DataDestTy, class _HashTy>
-inline status write_stream<_DataDestTy,_HashTy>::write_to_destination( const u8 *src, size_t count )
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_to_destination( const u8 *src, size_t count )
 {
+	// in async_hash mode, hash the data on the hash worker thread while it is written. (the data must not 
+	// be modified until the hashing is done, so the hash is always finished before returning)
+	if( this->async_hash )
+	{
+		this->hash_worker.submit( [this,src,count]() { return this->hasher.update(src, count); } );
+		const status write_result = this->write_blocks( std::integral_constant<bool, _TransformTy::is_noop>(), src, count );
+		ctStatusCall(this->hash_worker.wait());
+		ctStatusCall(write_result);
+		return status::ok;
+	}
+
 	ctStatusCall(this->hasher.update(src, count));
+	ctStatusCall(this->write_blocks( std::integral_constant<bool, _TransformTy::is_noop>(), src, count ));
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_blocks( std::true_type, const u8 *src, size_t count )
+{
+	return this->write_raw( src, count );
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_blocks( std::false_type, const u8 *src, size_t count )
+{
+	// encode the data in blocks of at most the buffer size, and at most max_block_size
+	const size_t header_size = 8;
+	const size_t block_size_limit = std::min<size_t>( this->buffer_size, max_block_size );
+	while( count > 0 )
+	{
+		const size_t block_size = std::min( count, block_size_limit );
+		const size_t capacity = this->transform.max_encoded_size( block_size );
+		this->encoded_block.resize( header_size + capacity );
+		size_t encoded_size = 0;
+		ctStatusReturnCall(encoded_size, this->transform.encode( src, block_size, &this->encoded_block[header_size], capacity ));
+
+		// write the header with the encoded and decoded sizes (big-endian), followed by the encoded block. 
+		// if the block did not get smaller, store the block as is instead
+		const bool store_as_is = ( encoded_size >= block_size );
+		to_bigendian<u32>( &this->encoded_block[0], u32( store_as_is ? block_size : encoded_size ) );
+		to_bigendian<u32>( &this->encoded_block[4], u32( block_size ) );
+		if( store_as_is )
+		{
+			ctStatusCall(this->write_raw( this->encoded_block.data(), header_size ));
+			ctStatusCall(this->write_raw( src, block_size ));
+		}
+		else
+		{
+			ctStatusCall(this->write_raw( this->encoded_block.data(), header_size + encoded_size ));
+		}
+
+		src += block_size;
+		count -= block_size;
+	}
+
+	return status::ok;
+}
+
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::write_raw( const u8 *src, size_t count )
+{
 	size_t written_count = 0;
 	ctStatusReturnCall(written_count, this->data_dest.write(src, count));
 	ctValidate( written_count == count, status::cant_write ) << "The write operation failed. " << written_count << " of " << count << " bytes were written." << ctValidateEnd;
 	return status::ok;
 }
 
-template<class _DataDestTy, class _HashTy>
-inline status write_stream<_DataDestTy,_HashTy>::flush_buffer()
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::flush_buffer()
 {
 	if( this->buffer_position > 0 )
-		ctStatusCall( this->write_to_destination( this->buffer.data(), this->buffer_position ) );
+	{
+		if( this->async_write )
+		{
+			// wait for the previous buffer to be written, and hand over the current buffer to the write worker
+			ctStatusCall( this->wait_for_pending_write() );
+			std::swap( this->buffer, this->back_buffer );
+			const u8* const src = this->back_buffer;
+			const size_t count = this->buffer_position;
+			this->write_worker.submit( [this,src,count]() { return this->write_to_destination(src, count); } );
+		}
+		else
+		{
+			ctStatusCall( this->write_to_destination( this->buffer, this->buffer_position ) );
+		}
+	}
 	this->buffer_position = 0;
 
 	return status::ok;
 }
 
+template<class _DataDestTy, class _HashTy, class _TransformTy>
+inline status write_stream<_DataDestTy,_HashTy,_TransformTy>::wait_for_pending_write()
+{
+	if( this->async_write )
+		ctStatusCall( this->write_worker.wait() );
+	return status::ok;
+}
+
 }
 // namespace ctle
 
 #include "_undef_macros.inl"
+
+inline ctle::write_stream_flags operator| ( const ctle::write_stream_flags &a, const ctle::write_stream_flags &b )
+{
+	return (ctle::write_stream_flags)( (int)a | (int)b );
+}
+
 #endif//_CTLE_WRITE_STREAM_H_
@@ -9,6 +9,8 @@
 #include <thread>
 
 #include <ctle/data_destination.h>
+#include <ctle/tee_data_destination.h>
+#include <ctle/write_stream.h>
 
 using namespace ctle;
 
@@ -42,3 +44,48 @@ TEST( data_destination, file_test )
 
 	EXPECT_TRUE( read_buffer == file_data );
 }
+
+TEST( data_destination, tee_test )
+{
+	const char *data_destination_files[2] = { "data_destination_tee_test_a.dat", "data_destination_tee_test_b.dat" };
+	const auto data = random_vector<u8>( 10 * 1024 * 1024 + random_value<u32>() % 1000 );
+
+	// write to two files and a memory destination, through a write_stream
+	std::vector<u8> memory_data;
+	if( true )
+	{
+		file_data_destination first(data_destination_files[0]);
+		file_data_destination second(data_destination_files[1]);
+		memory_data_destination memory(memory_data);
+		auto tee = make_tee_data_destination( first, second, memory );
+		EXPECT_EQ( tee.destination_count(), 3 );
+
+		write_stream<decltype(tee),hasher_xxh128> ws(tee, write_stream_flags::async_write, 256 * 1024);
+		for( size_t inx = 0; inx < data.size(); )
+		{
+			const size_t block_size = std::min( (size_t)random_value<u32>() % 100000, data.size() - inx );
+			ASSERT_EQ( ws.write( &data[inx], block_size ), status::ok );
+			inx += block_size;
+		}
+		ASSERT_EQ( ws.end(), status::ok );
+	}
+	for( const char *filename : data_destination_files )
+	{
+		std::vector<u8> file_data;
+		ASSERT_EQ( read_file( filename, file_data ), status::ok );
+		EXPECT_TRUE( file_data == data );
+	}
+	EXPECT_TRUE( memory_data == data );
+
+	// an error in any of the destinations is reported
+	if( true )
+	{
+		std::vector<u8> arena( 1000 );
+		memory_data_destination memory;
+		memory_data_destination small_memory(arena.data(), arena.size());
+		tee_data_destination<memory_data_destination,memory_data_destination> tee( memory, small_memory );
+		EXPECT_EQ( tee.write( data.data(), 500 ).status(), status::ok );
+		EXPECT_EQ( tee.write( data.data(), 1000 ).status(), status::cant_write );
+		EXPECT_EQ( memory.size(), 1500 );
+	}
+}
@@ -37,3 +37,45 @@ TEST( data_source, file_test )
 
 	EXPECT_TRUE( read_buffer == file_data );
 }
+
+TEST( data_source, mmap_test )
+{
+	const char *data_source_file = "data_source_mmap_test.dat";
+	constexpr const size_t file_size = 100000;
+	auto file_data = random_vector<u8>(file_size);
+
+	// write a file using the write_file function
+	ASSERT_EQ( write_file(data_source_file, file_data, true ), status::ok );
+
+	// read file using a random number of block sizes and calls, and compare results
+	std::vector<u8> read_buffer(file_size);
+	if( true )
+	{
+		mmap_data_source ds(data_source_file);
+		ASSERT_EQ( ds.size(), file_size );
+		EXPECT_EQ( memcmp( ds.data(), file_data.data(), file_size ), 0 );
+
+		size_t read_bytes = 0;
+		while( read_bytes < file_size )
+		{
+			u64 read_chunk_size = random_value<u64>() % 1000;
+			auto result = ds.read( &read_buffer.data()[read_bytes], read_chunk_size );
+			ASSERT_EQ( result.status(), status::ok );
+			EXPECT_TRUE( result.value() <= read_chunk_size );
+			read_bytes += result.value();
+		}
+		EXPECT_TRUE( ds.read( nullptr, 0 ).value() == 0 ); // making sure that 0 is fine with nullptr
+		ASSERT_EQ( read_bytes, file_size );
+	}
+
+	EXPECT_TRUE( read_buffer == file_data );
+
+	// an empty file maps to an empty source
+	ASSERT_EQ( write_file(data_source_file, std::vector<u8>(), true ), status::ok );
+	if( true )
+	{
+		mmap_data_source ds(data_source_file);
+		EXPECT_EQ( ds.size(), 0 );
+		EXPECT_TRUE( ds.read( nullptr, 10 ).value() == 0 );
+	}
+}
@@ -13,6 +13,7 @@
 #include <ctle/write_stream.h>
 #include <ctle/data_destination.h>
 #include <ctle/ntup.h>
+#include <ctle/hasher_tree.h>
 
 using namespace ctle;
 
@@ -72,3 +73,922 @@ TEST( data_stream, basic_test )
 	}
 
 }
+
+template<class _DataSourceTy>
+static void test_read_stream_spans( const char *filename, const std::vector<u8> &file_data, read_stream_flags flags = {} )
+{
+	_DataSourceTy ds(filename);
+	read_stream<_DataSourceTy,hasher_xxh128> rs(ds,flags);
+
+	// read random sized spans, which will straddle the buffer boundaries, and compare to the source data
+	size_t read_bytes = 0;
+	while( read_bytes < file_data.size() )
+	{
+		const size_t span_size = std::min( (size_t)(random_value<u32>() % 100000), file_data.size() - read_bytes );
+		auto span = rs.read_span( span_size );
+		ASSERT_EQ( span.status(), status::ok );
+		EXPECT_EQ( memcmp( span.value(), &file_data[read_bytes], span_size ), 0 );
+		read_bytes += span_size;
+		EXPECT_EQ( rs.get_position(), read_bytes );
+	}
+	EXPECT_TRUE( rs.has_ended() );
+	EXPECT_FALSE( rs.read_span( 1 ).status() );
+
+	// the digest must be the same as a direct hash of the data
+	hasher_xxh128 hasher;
+	hasher.update( file_data.data(), file_data.size() );
+	EXPECT_EQ( rs.get_digest().value(), hasher.finish().value() );
+}
+
+TEST( data_stream, mmap_and_span_test )
+{
+	const char *filename = "./data_stream_mmap_test.dat";
+	const size_t file_size = 5 * 1024 * 1024 + (random_value<u32>() % 100000);
+	auto file_data = random_vector<u8>( file_size );
+	ASSERT_EQ( write_file( filename, file_data, true ), status::ok );
+
+	test_read_stream_spans<file_data_source>( filename, file_data );
+	test_read_stream_spans<mmap_data_source>( filename, file_data );
+	test_read_stream_spans<file_data_source>( filename, file_data, read_stream_flags::async_read );
+	test_read_stream_spans<file_data_source>( filename, file_data, read_stream_flags::async_read | read_stream_flags::async_hash );
+	test_read_stream_spans<mmap_data_source>( filename, file_data, read_stream_flags::async_hash );
+
+	// read the file with a mmap source, using the regular read methods
+	if( true )
+	{
+		mmap_data_source ds(filename);
+		read_stream<mmap_data_source> rs(ds);
+		std::vector<u8> read_data( file_size );
+		ASSERT_EQ( rs.read( read_data.data(), 1 ), status::ok );
+		ASSERT_EQ( rs.read( &read_data[1], file_size-1 ), status::ok );
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_TRUE( read_data == file_data );
+	}
+}
+
+TEST( data_stream, async_read_test )
+{
+	const char *filename = "./data_stream_async_read_test.dat";
+	const size_t file_size = 7 * 1024 * 1024 + (random_value<u32>() % 100000);
+	auto file_data = random_vector<u8>( file_size );
+	ASSERT_EQ( write_file( filename, file_data, true ), status::ok );
+
+	// read the file in random sized blocks, using both sync and async reads, and compare the results
+	digest<128> digests[2];
+	for( size_t pass = 0; pass < 2; ++pass )
+	{
+		file_data_source ds(filename);
+		read_stream<file_data_source,hasher_xxh128> rs(ds, (pass == 0) ? read_stream_flags{} : read_stream_flags::async_read );
+
+		std::vector<u8> read_data( file_size );
+		size_t read_bytes = 0;
+		while( read_bytes < file_size )
+		{
+			const size_t block_size = std::min( (size_t)(random_value<u32>() % 3000000), file_size - read_bytes );
+			ASSERT_EQ( rs.read_bytes( &read_data[read_bytes], block_size ), status::ok );
+			read_bytes += block_size;
+		}
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_TRUE( read_data == file_data );
+		digests[pass] = rs.get_digest().value();
+	}
+	EXPECT_EQ( digests[0], digests[1] );
+
+	// make sure a stream which is destroyed before it is fully read is correctly shut down
+	if( true )
+	{
+		file_data_source ds(filename);
+		read_stream<file_data_source> rs(ds, read_stream_flags::async_read);
+		u64 first_value = 0;
+		memcpy( &first_value, file_data.data(), sizeof(first_value) );
+		EXPECT_EQ( rs.read<u64>(), first_value );
+	}
+}
+
+TEST( data_stream, unbuffered_test )
+{
+	const char *filename = "./data_stream_unbuffered_test.dat";
+	const size_t data_size = 5 * 1024 * 1024 + (random_value<u32>() % 100000);
+	auto data = random_vector<u8>( data_size );
+
+	// write and read the file unbuffered through streams with aligned buffers, the unaligned tail is transferred buffered
+	digest<128> write_digest;
+	if( true )
+	{
+		file_data_destination dd( filename, true, true );
+		write_stream<file_data_destination,hasher_xxh128> ws( dd, write_stream_flags::async_write, 1024 * 1024 );
+		ws.write_bytes( data.data(), data.size() );
+		ASSERT_EQ( ws.end(), status::ok );
+		write_digest = ws.get_digest().value();
+	}
+	if( true )
+	{
+		file_data_source ds( filename, true );
+		read_stream<file_data_source,hasher_xxh128> rs( ds, read_stream_flags::async_read, 1024 * 1024 );
+		std::vector<u8> read_data( data_size );
+		ASSERT_EQ( rs.read_bytes( read_data.data(), data_size ), status::ok );
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_TRUE( read_data == data );
+		EXPECT_EQ( rs.get_digest().value(), write_digest );
+	}
+}
+
+// a data destination which fails when more than a set number of bytes have been written
+class failing_data_destination
+{
+public:
+	failing_data_destination( u64 _fail_after ) : fail_after(_fail_after) {}
+
+	status_return<status, u64> write(const u8* /*src_buffer*/, u64 write_count)
+	{
+		this->written += write_count;
+		if( this->written > this->fail_after )
+			return status::cant_write;
+		return write_count;
+	}
+
+private:
+	u64 fail_after = 0;
+	u64 written = 0;
+};
+
+TEST( data_stream, async_write_test )
+{
+	const char *filenames[2] = { "./data_stream_sync_write_test.dat" , "./data_stream_async_write_test.dat" };
+	const size_t data_size = 9 * 1024 * 1024 + (random_value<u32>() % 100000);
+	auto data = random_vector<u8>( data_size );
+
+	// write the data in random sized blocks, using both sync and async writes
+	digest<128> digests[2];
+	for( size_t pass = 0; pass < 2; ++pass )
+	{
+		file_data_destination dd(filenames[pass]);
+		write_stream<file_data_destination,hasher_xxh128> ws(dd, (pass == 0) ? write_stream_flags{} : write_stream_flags::async_write );
+
+		size_t written_bytes = 0;
+		while( written_bytes < data_size )
+		{
+			const size_t block_size = std::min( (size_t)(random_value<u32>() % 3000000), data_size - written_bytes );
+			ASSERT_EQ( ws.write_bytes( &data[written_bytes], block_size ), status::ok );
+			written_bytes += block_size;
+		}
+		ASSERT_EQ( ws.end(), status::ok );
+		EXPECT_EQ( ws.end(), status::ok ); // ending an ended stream is a noop
+		digests[pass] = ws.get_digest().value();
+	}
+	EXPECT_EQ( digests[0], digests[1] );
+
+	// read back the files and compare
+	for( size_t pass = 0; pass < 2; ++pass )
+	{
+		std::vector<u8> file_data;
+		ASSERT_EQ( read_file( filenames[pass], file_data ), status::ok );
+		EXPECT_TRUE( file_data == data );
+	}
+
+	// a failed background write must be reported by a later call
+	if( true )
+	{
+		failing_data_destination dd( 3 * 1024 * 1024 );
+		write_stream<failing_data_destination> ws(dd, write_stream_flags::async_write);
+		status result = status::ok;
+		for( size_t inx = 0; inx < 8 && result; ++inx )
+			result = ws.write_bytes( data.data(), 1024 * 1024 );
+		if( result )
+			result = ws.end();
+		EXPECT_EQ( result, status::cant_write );
+	}
+}
+
+TEST( data_stream, buffer_size_test )
+{
+	const char *filename = "./data_stream_buffer_size_test.dat";
+	const size_t data_size = 200000 + (random_value<u32>() % 100000);
+	auto data = random_vector<u8>( data_size );
+
+	// the buffer size can not be 0
+	if( true )
+	{
+		file_data_destination dd(filename);
+		EXPECT_THROW( (write_stream<file_data_destination>(dd, write_stream_flags{}, 0)), ctle::status_error );
+		EXPECT_THROW( (write_stream<file_data_destination>(dd, nullptr, 1024)), ctle::status_error );
+	}
+
+	// write and read back the data with a number of different buffer sizes, using both allocated and 
+	// caller supplied buffers. reuse the same supplied buffer for all the streams.
+	const size_t buffer_sizes[] = { 61, 4096, 65536 + 7, 1024 * 1024 };
+	std::vector<u8> external_buffer( 2 * 1024 * 1024 );
+	for( size_t buffer_size : buffer_sizes )
+	{
+		for( size_t pass = 0; pass < 4; ++pass )
+		{
+			const bool use_external = (pass & 1) != 0;
+			const bool use_async = (pass & 2) != 0;
+			const size_t external_size = use_async ? 2 * buffer_size : buffer_size;
+
+			digest<128> write_digest;
+			if( true )
+			{
+				const write_stream_flags flags = use_async ? write_stream_flags::async_write : write_stream_flags{};
+				file_data_destination dd(filename);
+				std::unique_ptr<write_stream<file_data_destination,hasher_xxh128>> ws;
+				if( use_external )
+					ws.reset( new write_stream<file_data_destination,hasher_xxh128>(dd, external_buffer.data(), external_size, flags) );
+				else
+					ws.reset( new write_stream<file_data_destination,hasher_xxh128>(dd, flags, buffer_size) );
+				EXPECT_EQ( ws->get_buffer_size(), buffer_size );
+
+				size_t written_bytes = 0;
+				while( written_bytes < data_size )
+				{
+					const size_t block_size = std::min( (size_t)(random_value<u32>() % 10000), data_size - written_bytes );
+					ASSERT_EQ( ws->write_bytes( &data[written_bytes], block_size ), status::ok );
+					written_bytes += block_size;
+				}
+				ASSERT_EQ( ws->end(), status::ok );
+				write_digest = ws->get_digest().value();
+			}
+
+			if( true )
+			{
+				const read_stream_flags flags = use_async ? read_stream_flags::async_read : read_stream_flags{};
+				file_data_source ds(filename);
+				std::unique_ptr<read_stream<file_data_source,hasher_xxh128>> rs;
+				if( use_external )
+					rs.reset( new read_stream<file_data_source,hasher_xxh128>(ds, external_buffer.data(), external_size, flags) );
+				else
+					rs.reset( new read_stream<file_data_source,hasher_xxh128>(ds, flags, buffer_size) );
+				EXPECT_EQ( rs->get_buffer_size(), buffer_size );
+
+				std::vector<u8> read_data( data_size );
+				size_t read_bytes = 0;
+				while( read_bytes < data_size )
+				{
+					const size_t block_size = std::min( (size_t)(random_value<u32>() % 10000), data_size - read_bytes );
+					ASSERT_EQ( rs->read_bytes( &read_data[read_bytes], block_size ), status::ok );
+					read_bytes += block_size;
+				}
+				EXPECT_TRUE( rs->has_ended() );
+				EXPECT_TRUE( read_data == data );
+				EXPECT_EQ( rs->get_digest().value(), write_digest );
+			}
+		}
+	}
+}
+
+// the digests of async_hash streams must be the same as the digests of inline hashing streams
+TEST( data_stream, async_hash_digest_test )
+{
+	const char *filename = "./data_stream_async_hash_digest_test.dat";
+	auto data = random_vector<u8>( 200000 + ( random_value<u32>() % 100000 ) );
+	const size_t block_size = 4096;
+	const size_t buffer_size = 64 * 1024;
+
+	const write_stream_flags write_flags[2] = { write_stream_flags{} , write_stream_flags::async_write | write_stream_flags::async_hash };
+	const read_stream_flags read_flags[2] = { read_stream_flags{} , read_stream_flags::async_read | read_stream_flags::async_hash };
+	digest<256> digests[2][2];
+
+	for( size_t pass = 0; pass < 2; ++pass )
+	{
+		if( true )
+		{
+			file_data_destination dd(filename);
+			write_stream<file_data_destination,hasher_sha256> ws(dd, write_flags[pass], buffer_size);
+			for( size_t pos = 0; pos < data.size(); pos += block_size )
+				ASSERT_EQ( ws.write_bytes( &data[pos], std::min( block_size, data.size() - pos ) ), status::ok );
+			ASSERT_EQ( ws.end(), status::ok );
+			digests[pass][0] = ws.get_digest().value();
+		}
+
+		if( true )
+		{
+			file_data_source ds(filename);
+			read_stream<file_data_source,hasher_sha256> rs(ds, read_flags[pass], buffer_size);
+			std::vector<u8> read_data( data.size() );
+			for( size_t pos = 0; pos < data.size(); pos += block_size )
+				ASSERT_EQ( rs.read_bytes( &read_data[pos], std::min( block_size, data.size() - pos ) ), status::ok );
+			EXPECT_TRUE( rs.has_ended() );
+			EXPECT_TRUE( read_data == data );
+			digests[pass][1] = rs.get_digest().value();
+		}
+	}
+
+	// all digests must be the same as a direct hash of the data
+	hasher_sha256 hasher;
+	hasher.update( data.data(), data.size() );
+	const digest<256> expected = hasher.finish().value();
+	for( size_t pass = 0; pass < 2; ++pass )
+	{
+		EXPECT_EQ( digests[pass][0], expected );
+		EXPECT_EQ( digests[pass][1], expected );
+	}
+}
+
+TEST( data_stream, bigendian_test )
+{
+	const char *filename = "./data_stream_bigendian_test.dat";
+	const size_t value_count = 2000 + (random_value<u32>() % 1000);
+	auto values16 = random_vector<u16>( value_count );
+	auto values32 = random_vector<u32>( value_count );
+	auto values64 = random_vector<u64>( value_count );
+	auto valuesf = random_vector<float>( value_count );
+
+	// use buffer sizes which are smaller than the values, and which are not multiples of the value sizes
+	const size_t buffer_sizes[] = { 3, 13, 4096, write_stream<file_data_destination>::default_buffer_size };
+	for( size_t buffer_size : buffer_sizes )
+	{
+		// write the values in random sized blocks, with a single byte between the arrays, to misalign the values
+		if( true )
+		{
+			file_data_destination dd(filename);
+			write_stream<file_data_destination> ws(dd, write_stream_flags{}, buffer_size);
+			ASSERT_EQ( ws.write_bigendian( values16.data(), value_count ), status::ok );
+			ASSERT_EQ( ws.write<u8>( 0x12 ), status::ok );
+			ASSERT_EQ( ws.write_bigendian( values32.data(), value_count ), status::ok );
+			const i8 separator = 0x34;
+			ASSERT_EQ( ws.write_bigendian( &separator, 1 ), status::ok );
+			for( size_t inx = 0; inx < value_count; )
+			{
+				const size_t block_size = std::min( (size_t)(random_value<u32>() % 100), value_count - inx );
+				ASSERT_EQ( ws.write_bigendian( &values64[inx], block_size ), status::ok );
+				inx += block_size;
+			}
+			ASSERT_EQ( ws.write_bigendian( valuesf.data(), value_count ), status::ok );
+			EXPECT_EQ( ws.get_position(), value_count * 18 + 2 );
+			ASSERT_EQ( ws.end(), status::ok );
+		}
+
+		// check the raw data
+		std::vector<u8> file_data;
+		ASSERT_EQ( read_file( filename, file_data ), status::ok );
+		ASSERT_EQ( file_data.size(), value_count * 18 + 2 );
+		const u8 *p = file_data.data();
+		for( size_t inx = 0; inx < value_count; ++inx, p += 2 )
+			EXPECT_EQ( from_bigendian<u16>( p ), values16[inx] );
+		EXPECT_EQ( *p++, 0x12 );
+		for( size_t inx = 0; inx < value_count; ++inx, p += 4 )
+			EXPECT_EQ( from_bigendian<u32>( p ), values32[inx] );
+		EXPECT_EQ( *p++, 0x34 );
+		for( size_t inx = 0; inx < value_count; ++inx, p += 8 )
+			EXPECT_EQ( from_bigendian<u64>( p ), values64[inx] );
+
+		// read back the values, using both sync and async reads
+		for( size_t pass = 0; pass < 2; ++pass )
+		{
+			file_data_source ds(filename);
+			read_stream<file_data_source> rs(ds, (pass == 0) ? read_stream_flags{} : read_stream_flags::async_read, buffer_size);
+			std::vector<u16> read16( value_count );
+			std::vector<u32> read32( value_count );
+			std::vector<u64> read64( value_count );
+			std::vector<float> readf( value_count );
+			ASSERT_EQ( rs.read_bigendian( read16.data(), value_count ), status::ok );
+			EXPECT_EQ( rs.read<u8>(), 0x12 );
+			ASSERT_EQ( rs.read_bigendian( read32.data(), value_count ), status::ok );
+			i8 separator = 0;
+			ASSERT_EQ( rs.read_bigendian( &separator, 1 ), status::ok );
+			EXPECT_EQ( separator, 0x34 );
+			for( size_t inx = 0; inx < value_count; )
+			{
+				const size_t block_size = std::min( (size_t)(random_value<u32>() % 100), value_count - inx );
+				ASSERT_EQ( rs.read_bigendian( &read64[inx], block_size ), status::ok );
+				inx += block_size;
+			}
+			ASSERT_EQ( rs.read_bigendian( readf.data(), value_count ), status::ok );
+			EXPECT_EQ( rs.get_position(), value_count * 18 + 2 );
+			EXPECT_TRUE( rs.has_ended() );
+			EXPECT_NE( rs.read_bigendian( read16.data(), 1 ), status::ok );
+
+			EXPECT_TRUE( read16 == values16 );
+			EXPECT_TRUE( read32 == values32 );
+			EXPECT_TRUE( read64 == values64 );
+			EXPECT_EQ( memcmp( readf.data(), valuesf.data(), value_count * sizeof(float) ), 0 );
+		}
+	}
+}
+
+TEST( data_stream, varint_test )
+{
+	const char *filename = "./data_stream_varint_test.dat";
+	const size_t value_count = 5000 + (random_value<u32>() % 1000);
+
+	// mostly small values, with some random large values
+	std::vector<u32> values32( value_count );
+	std::vector<i64> values64( value_count );
+	for( size_t inx = 0; inx < value_count; ++inx )
+	{
+		values32[inx] = ( inx % 7 == 0 ) ? random_value<u32>() : u32( inx % 200 );
+		values64[inx] = ( inx % 5 == 0 ) ? random_value<i64>() : i64( inx % 100 ) - 50;
+	}
+
+	const size_t buffer_sizes[] = { 1, 4, 11, 4096, write_stream<file_data_destination>::default_buffer_size };
+	for( size_t buffer_size : buffer_sizes )
+	{
+		u64 end_position = 0;
+		if( true )
+		{
+			file_data_destination dd(filename);
+			write_stream<file_data_destination> ws(dd, write_stream_flags{}, buffer_size);
+			ASSERT_EQ( ws.write_varint( (u32)value_count ), status::ok );
+			ASSERT_EQ( ws.write_varint( values32.data(), value_count ), status::ok );
+			for( size_t inx = 0; inx < value_count; )
+			{
+				const size_t block_size = std::min( (size_t)(random_value<u32>() % 100), value_count - inx );
+				ASSERT_EQ( ws.write_varint( &values64[inx], block_size ), status::ok );
+				inx += block_size;
+			}
+			ASSERT_EQ( ws.write<u8>( 0xff ), status::ok );
+			end_position = ws.get_position();
+			ASSERT_EQ( ws.end(), status::ok );
+
+			// the varints must be smaller than the raw values
+			EXPECT_LT( end_position, value_count * (sizeof(u32) + sizeof(i64)) );
+		}
+
+		for( size_t pass = 0; pass < 2; ++pass )
+		{
+			file_data_source ds(filename);
+			read_stream<file_data_source> rs(ds, (pass == 0) ? read_stream_flags{} : read_stream_flags::async_read, buffer_size);
+			EXPECT_EQ( rs.read_varint<u32>(), (u32)value_count );
+			std::vector<u32> read32( value_count );
+			std::vector<i64> read64( value_count );
+			ASSERT_EQ( rs.read_varint( read32.data(), value_count ), status::ok );
+			for( size_t inx = 0; inx < value_count; )
+			{
+				const size_t block_size = std::min( (size_t)(random_value<u32>() % 100), value_count - inx );
+				ASSERT_EQ( rs.read_varint( &read64[inx], block_size ), status::ok );
+				inx += block_size;
+			}
+			EXPECT_EQ( rs.read<u8>(), 0xff );
+			EXPECT_EQ( rs.get_position(), end_position );
+			EXPECT_TRUE( rs.has_ended() );
+			EXPECT_TRUE( read32 == values32 );
+			EXPECT_TRUE( read64 == values64 );
+		}
+	}
+
+	// invalid encodings and premature end of stream must be detected
+	if( true )
+	{
+		const std::vector<u8> invalid_data = { 0x01, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 };
+		ASSERT_EQ( write_file( filename, invalid_data, true ), status::ok );
+		file_data_source ds(filename);
+		read_stream<file_data_source> rs(ds);
+		u32 values[2] = {};
+		EXPECT_EQ( rs.read_varint( values, 2 ), status::corrupted );
+	}
+	if( true )
+	{
+		const std::vector<u8> truncated_data = { 0x01, 0x02, 0xff };
+		ASSERT_EQ( write_file( filename, truncated_data, true ), status::ok );
+		file_data_source ds(filename);
+		read_stream<file_data_source> rs(ds);
+		u32 values[3] = {};
+		EXPECT_EQ( rs.read_varint( values, 3 ), status::cant_read );
+	}
+}
+
+TEST( data_stream, transform_test )
+{
+	const char *filenames[2] = { "./data_stream_transform_noop_test.dat", "./data_stream_transform_lz_test.dat" };
+
+	// data with long runs of repeated values, and some random values
+	const size_t value_count = 1000000 + (random_value<u32>() % 1000);
+	std::vector<u32> values( value_count );
+	for( size_t inx = 0; inx < value_count; ++inx )
+		values[inx] = ( inx % 97 == 0 ) ? random_value<u32>() : u32( inx / 1000 );
+
+	// write the data without and with the lz transform
+	digest<128> digests[2];
+	if( true )
+	{
+		file_data_destination dd(filenames[0]);
+		write_stream<file_data_destination,hasher_xxh128> ws(dd);
+		ASSERT_EQ( ws.write( values.data(), value_count ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+		digests[0] = ws.get_digest().value();
+	}
+	if( true )
+	{
+		file_data_destination dd(filenames[1]);
+		write_stream<file_data_destination,hasher_xxh128,transform_lz> ws(dd, write_stream_flags::async_write, 256 * 1024);
+		for( size_t inx = 0; inx < value_count; )
+		{
+			// write a mix of small and large blocks, where large blocks bypass the buffer
+			const size_t block_size = std::min( (size_t)( (inx % 3 == 0) ? (random_value<u32>() % 200000) : (random_value<u32>() % 100) ), value_count - inx );
+			ASSERT_EQ( ws.write( &values[inx], block_size ), status::ok );
+			inx += block_size;
+		}
+		ASSERT_EQ( ws.end(), status::ok );
+		EXPECT_EQ( ws.get_position(), value_count * sizeof(u32) );
+		digests[1] = ws.get_digest().value();
+	}
+
+	// the digest is calculated on the untransformed data
+	EXPECT_EQ( digests[0], digests[1] );
+
+	// the compressed file must be smaller
+	std::vector<u8> file_data[2];
+	ASSERT_EQ( read_file( filenames[0], file_data[0] ), status::ok );
+	ASSERT_EQ( read_file( filenames[1], file_data[1] ), status::ok );
+	EXPECT_EQ( file_data[0].size(), value_count * sizeof(u32) );
+	EXPECT_LT( file_data[1].size(), file_data[0].size() / 2 );
+
+	// read back the compressed data with different buffer sizes, and from a mapped source
+	const size_t buffer_sizes[] = { 100, 64 * 1024, 1024 * 1024 };
+	for( size_t buffer_size : buffer_sizes )
+	{
+		for( size_t pass = 0; pass < 2; ++pass )
+		{
+			file_data_source ds(filenames[1]);
+			read_stream<file_data_source,hasher_xxh128,transform_lz> rs(ds, (pass == 0) ? read_stream_flags{} : read_stream_flags::async_read, buffer_size);
+			std::vector<u32> read_values( value_count );
+			ASSERT_EQ( rs.read( read_values.data(), value_count ), status::ok );
+			EXPECT_TRUE( rs.has_ended() );
+			EXPECT_TRUE( read_values == values );
+			EXPECT_EQ( rs.get_digest().value(), digests[0] );
+		}
+	}
+	if( true )
+	{
+		mmap_data_source ds(filenames[1]);
+		read_stream<mmap_data_source,hasher_xxh128,transform_lz> rs(ds);
+		std::vector<u32> read_values( value_count );
+		ASSERT_EQ( rs.read( read_values.data(), value_count ), status::ok );
+		EXPECT_TRUE( read_values == values );
+	}
+
+	// a truncated stream must be reported as corrupted
+	if( true )
+	{
+		file_data[1].resize( file_data[1].size() / 2 );
+		ASSERT_EQ( write_file( filenames[1], file_data[1], true ), status::ok );
+		file_data_source ds(filenames[1]);
+		read_stream<file_data_source,hasher_xxh128,transform_lz> rs(ds, read_stream_flags{}, 64 * 1024);
+		std::vector<u32> read_values( value_count );
+		EXPECT_EQ( rs.read( read_values.data(), value_count ), status::corrupted );
+	}
+
+	// a block header with a decoded size above the max block size must be rejected (when the stream fills the first buffer), before the block is allocated
+	if( true )
+	{
+		std::vector<u8> block_data( 8 + 16 );
+		to_bigendian<u32>( &block_data[0], 16 );
+		to_bigendian<u32>( &block_data[4], 0xf0000000 );
+		ASSERT_EQ( write_file( filenames[1], block_data, true ), status::ok );
+		file_data_source ds(filenames[1]);
+		EXPECT_THROW( (read_stream<file_data_source,hasher_xxh128,transform_lz>(ds)), ctle::status_error );
+	}
+}
+
+template<class _DataSourceTy>
+static void test_read_stream_records( const char *filename, const std::vector<std::vector<u8>> &records, const digest<128> &expected_digest, read_stream_flags flags, size_t buffer_size )
+{
+	// read all records in order, the footer is not part of the stream data
+	if( true )
+	{
+		_DataSourceTy ds(filename);
+		read_stream<_DataSourceTy,hasher_xxh128> rs(ds, flags | read_stream_flags::block_index, buffer_size);
+		ASSERT_EQ( rs.get_record_count(), records.size() );
+		for( size_t inx = 0; inx < records.size(); ++inx )
+		{
+			EXPECT_EQ( rs.get_position(), rs.get_block_index()[inx] );
+			std::vector<u8> record( records[inx].size() );
+			ASSERT_EQ( rs.read( record.data(), record.size() ), status::ok );
+			EXPECT_TRUE( record == records[inx] );
+		}
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_EQ( rs.get_digest().value(), expected_digest );
+	}
+
+	// read records in random order
+	if( true )
+	{
+		_DataSourceTy ds(filename);
+		read_stream<_DataSourceTy,hasher_xxh128> rs(ds, flags | read_stream_flags::block_index, buffer_size);
+		for( size_t pass = 0; pass < 200; ++pass )
+		{
+			const size_t inx = random_value<u32>() % records.size();
+			ASSERT_EQ( rs.seek_record( inx ), status::ok );
+			std::vector<u8> record( records[inx].size() );
+			ASSERT_EQ( rs.read( record.data(), record.size() ), status::ok );
+			EXPECT_TRUE( record == records[inx] );
+		}
+
+		// seeking to the end of the data ends the stream, and seeking past it fails
+		const u64 data_size = rs.get_block_index().back() + records.back().size();
+		ASSERT_EQ( rs.seek( data_size ), status::ok );
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_EQ( rs.seek( data_size + 1 ), status::invalid_param );
+		EXPECT_EQ( rs.seek_record( records.size() ), status::invalid_param );
+	}
+}
+
+TEST( data_stream, seek_test )
+{
+	const char *filename = "./data_stream_seek_test.dat";
+
+	// write records of random sizes, and mark each record in the block index
+	std::vector<std::vector<u8>> records( 500 );
+	digest<128> expected_digest;
+	if( true )
+	{
+		file_data_destination dd(filename);
+		write_stream<file_data_destination,hasher_xxh128> ws(dd, write_stream_flags::async_write | write_stream_flags::block_index, 64 * 1024);
+		for( auto &record : records )
+		{
+			record = random_vector<u8>( (random_value<u32>() % 20) ? (random_value<u32>() % 1000 + 1) : (random_value<u32>() % 200000 + 1) );
+			ASSERT_EQ( ws.mark_record(), status::ok );
+			ASSERT_EQ( ws.write( record.data(), record.size() ), status::ok );
+		}
+		EXPECT_EQ( ws.get_record_count(), records.size() );
+		ASSERT_EQ( ws.end(), status::ok );
+		expected_digest = ws.get_digest().value();
+	}
+
+	const size_t buffer_sizes[] = { 100, 4096, 1024 * 1024 };
+	for( size_t buffer_size : buffer_sizes )
+	{
+		test_read_stream_records<file_data_source>( filename, records, expected_digest, read_stream_flags{}, buffer_size );
+		test_read_stream_records<file_data_source>( filename, records, expected_digest, read_stream_flags::async_read, buffer_size );
+		test_read_stream_records<mmap_data_source>( filename, records, expected_digest, read_stream_flags{}, buffer_size );
+	}
+
+	// seeking within the buffer keeps the hash valid
+	if( true )
+	{
+		file_data_source ds(filename);
+		read_stream<file_data_source,hasher_xxh128> rs(ds, read_stream_flags::block_index);
+		std::vector<u8> record( records[0].size() );
+		ASSERT_EQ( rs.read( record.data(), record.size() ), status::ok );
+		ASSERT_EQ( rs.seek( 0 ), status::ok );
+		const u64 data_size = rs.get_block_index().back() + records.back().size();
+		record.resize( 1000 );
+		while( !rs.has_ended() )
+		{
+			const size_t count = (size_t)std::min<u64>( data_size - rs.get_position(), random_value<u32>() % 1000 + 1 );
+			ASSERT_EQ( rs.read( record.data(), count ), status::ok );
+		}
+		EXPECT_EQ( rs.get_digest().value(), expected_digest );
+	}
+
+	// the block index requires the footer, and a stream without a block index can not mark records
+	if( true )
+	{
+		file_data_destination dd(filename);
+		write_stream<file_data_destination> ws(dd);
+		EXPECT_EQ( ws.mark_record(), status::invalid_param );
+		ASSERT_EQ( ws.write( records[0].data(), records[0].size() ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+
+		file_data_source ds(filename);
+		EXPECT_THROW( (read_stream<file_data_source>(ds, read_stream_flags::block_index)), ctle::status_error );
+		EXPECT_THROW( (write_stream<file_data_destination,hasher_noop<64>,transform_lz>(dd, write_stream_flags::block_index)), ctle::status_error );
+	}
+}
+
+// a destination which writes to memory, and does not implement gather writes
+class memory_test_destination
+{
+public:
+	std::vector<u8> data;
+
+	status_return<status, u64> write( const u8* src_buffer, u64 write_count )
+	{
+		data.insert( data.end(), src_buffer, src_buffer + write_count );
+		return write_count;
+	}
+};
+
+template<class _DataDestTy> static void test_write_gather( _DataDestTy &dd, const std::vector<std::vector<write_span>> &writes, write_stream_flags flags, digest<128> &digest_out )
+{
+	write_stream<_DataDestTy,hasher_xxh128> ws(dd, flags, 64 * 1024);
+	u64 position = 0;
+	for( const auto &spans : writes )
+	{
+		ASSERT_EQ( ws.write_gather( spans.data(), spans.size() ), status::ok );
+		for( const auto &span : spans )
+			position += span.size;
+		EXPECT_EQ( ws.get_position(), position );
+	}
+	ASSERT_EQ( ws.end(), status::ok );
+	digest_out = ws.get_digest().value();
+}
+
+TEST( data_stream, write_gather_test )
+{
+	const char *filename = "./data_stream_write_gather_test.dat";
+	EXPECT_TRUE( is_gather_data_destination<file_data_destination>::value );
+	EXPECT_FALSE( is_gather_data_destination<memory_test_destination>::value );
+	EXPECT_TRUE( is_gather_data_destination<memory_data_destination>::value );
+
+	// set up groups of spans, which are mostly small fragments, and some large spans which do not fit in the buffer
+	const std::vector<u8> data = random_vector<u8>( 4 * 1024 * 1024 );
+	std::vector<std::vector<write_span>> writes( 2000 );
+	std::vector<u8> expected_data;
+	for( auto &spans : writes )
+	{
+		spans.resize( random_value<u32>() % 200 );
+		for( auto &span : spans )
+		{
+			const size_t size = ( random_value<u32>() % 500 ) ? ( random_value<u32>() % 16 ) : ( random_value<u32>() % 200000 );
+			const size_t offset = random_value<u32>() % ( data.size() - size );
+			span = { &data[offset], size };
+			expected_data.insert( expected_data.end(), &data[offset], &data[offset] + size );
+		}
+	}
+
+	// write with a gather destination, and with a destination which can't gather, which use write_bytes for each span
+	const write_stream_flags flags[] = { write_stream_flags{}, write_stream_flags::async_write | write_stream_flags::async_hash };
+	for( auto flag : flags )
+	{
+		digest<128> file_digest;
+		if( true )
+		{
+			file_data_destination dd(filename);
+			test_write_gather( dd, writes, flag, file_digest );
+		}
+		std::vector<u8> file_data;
+		ASSERT_EQ( read_file( filename, file_data ), status::ok );
+		EXPECT_TRUE( file_data == expected_data );
+
+		digest<128> memory_digest;
+		memory_test_destination md;
+		test_write_gather( md, writes, flag, memory_digest );
+		EXPECT_TRUE( md.data == expected_data );
+		EXPECT_EQ( file_digest, memory_digest );
+
+		std::vector<u8> gather_data;
+		memory_data_destination gd(gather_data);
+		test_write_gather( gd, writes, flag, memory_digest );
+		EXPECT_TRUE( gather_data == expected_data );
+		EXPECT_EQ( file_digest, memory_digest );
+	}
+}
+
+TEST( data_stream, memory_stream_test )
+{
+	const std::vector<u64> values = random_vector<u64>( 100000 + (random_value<u32>() % 1000) );
+	const size_t data_size = values.size() * sizeof(u64);
+
+	// write to a vector owned by the destination, and to a vector owned by the caller, with small buffers to do many writes
+	digest<128> expected_digest;
+	memory_data_destination owned_dest;
+	std::vector<u8> dest_vector = { 1, 2, 3 };
+	if( true )
+	{
+		write_stream<memory_data_destination,hasher_xxh128> ws(owned_dest, write_stream_flags{}, 1000);
+		ASSERT_EQ( ws.write( values.data(), values.size() ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+		expected_digest = ws.get_digest().value();
+		ASSERT_EQ( owned_dest.size(), data_size );
+		EXPECT_EQ( memcmp( owned_dest.data(), values.data(), data_size ), 0 );
+
+		memory_data_destination dd(dest_vector);
+		write_stream<memory_data_destination,hasher_xxh128> ws2(dd, write_stream_flags::async_write, 1000);
+		for( const u64 value : values )
+			ASSERT_EQ( ws2.write( value ), status::ok );
+		ASSERT_EQ( ws2.end(), status::ok );
+		ASSERT_EQ( dest_vector.size(), data_size + 3 );
+		EXPECT_EQ( dest_vector[2], 3 );
+		EXPECT_EQ( memcmp( &dest_vector[3], values.data(), data_size ), 0 );
+	}
+
+	// write to a fixed arena, which fails when the arena is full
+	std::vector<u8> arena( data_size );
+	if( true )
+	{
+		memory_data_destination dd(arena.data(), arena.size());
+		write_stream<memory_data_destination,hasher_xxh128> ws(dd);
+		ASSERT_EQ( ws.write( values.data(), values.size() ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+		EXPECT_EQ( dd.size(), data_size );
+		EXPECT_EQ( memcmp( arena.data(), values.data(), data_size ), 0 );
+
+		memory_data_destination small_dd(arena.data(), 100);
+		EXPECT_EQ( small_dd.write( arena.data(), 64 ).status(), status::ok );
+		EXPECT_EQ( small_dd.write( arena.data(), 64 ).status(), status::cant_write );
+	}
+
+	// read back from memory, the spans point directly into the source memory
+	if( true )
+	{
+		memory_data_source ds(arena.data(), arena.size());
+		read_stream<memory_data_source,hasher_xxh128> rs(ds, read_stream_flags{}, 1000);
+		auto span = rs.read_span( 8 );
+		ASSERT_EQ( span.status(), status::ok );
+		EXPECT_EQ( span.value(), arena.data() );
+		EXPECT_EQ( rs.read<u64>(), values[1] );
+		std::vector<u64> read_values( values.size() - 2 );
+		ASSERT_EQ( rs.read( read_values.data(), read_values.size() ), status::ok );
+		EXPECT_TRUE( std::equal( read_values.begin(), read_values.end(), values.begin() + 2 ) );
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_EQ( rs.get_digest().value(), expected_digest );
+	}
+}
+
+TEST( data_stream, split_file_test )
+{
+	const char *filename = "./data_stream_split_file_test.dat";
+	const u64 segment_size = 100000;
+
+	// write a first split file with more segments, to check that the stale segments are removed
+	if( true )
+	{
+		split_file_data_destination dd(filename, segment_size / 10);
+		write_stream<split_file_data_destination> ws(dd);
+		ASSERT_EQ( ws.write( random_vector<u8>( 2 * 1024 * 1024 ).data(), 2 * 1024 * 1024 ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+		EXPECT_GT( dd.get_segment_count(), 200 );
+	}
+
+	// write records, with a block index, which roll over to new segments
+	std::vector<std::vector<u8>> records( 300 );
+	digest<128> expected_digest;
+	u64 data_size = 0;
+	if( true )
+	{
+		split_file_data_destination dd(filename, segment_size);
+		write_stream<split_file_data_destination,hasher_xxh128> ws(dd, write_stream_flags::async_write | write_stream_flags::block_index, 64 * 1024);
+		for( auto &record : records )
+		{
+			record = random_vector<u8>( random_value<u32>() % 10000 + 1 );
+			data_size += record.size();
+			ASSERT_EQ( ws.mark_record(), status::ok );
+			ASSERT_EQ( ws.write( record.data(), record.size() ), status::ok );
+		}
+		ASSERT_EQ( ws.end(), status::ok );
+		expected_digest = ws.get_digest().value();
+
+		// the size includes the block index footer
+		const u64 file_size = data_size + ( records.size() + 2 ) * sizeof(u64);
+		EXPECT_EQ( dd.get_segment_count(), ( file_size + segment_size - 1 ) / segment_size );
+	}
+
+	// all segments are full, except the last one, and the segments are plain files
+	if( true )
+	{
+		split_file_data_source ds(filename);
+		EXPECT_EQ( ds.size(), data_size + ( records.size() + 2 ) * sizeof(u64) );
+		for( size_t inx = 0; inx < ds.get_segment_count(); ++inx )
+		{
+			std::vector<u8> segment_data;
+			ASSERT_EQ( read_file( split_file_segment_path( filename, inx ), segment_data ), status::ok );
+			EXPECT_EQ( segment_data.size(), std::min( segment_size, ds.size() - inx * segment_size ) );
+		}
+	}
+
+	// read back the records in order, and in random order
+	const read_stream_flags flags[] = { read_stream_flags::block_index, read_stream_flags::block_index | read_stream_flags::async_read };
+	for( auto flag : flags )
+	{
+		split_file_data_source ds(filename);
+		read_stream<split_file_data_source,hasher_xxh128> rs(ds, flag, 16 * 1024);
+		ASSERT_EQ( rs.get_record_count(), records.size() );
+		for( const auto &record : records )
+		{
+			std::vector<u8> read_record( record.size() );
+			ASSERT_EQ( rs.read( read_record.data(), read_record.size() ), status::ok );
+			EXPECT_TRUE( read_record == record );
+		}
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_EQ( rs.get_digest().value(), expected_digest );
+
+		for( size_t pass = 0; pass < 100; ++pass )
+		{
+			const size_t inx = random_value<u32>() % records.size();
+			ASSERT_EQ( rs.seek_record( inx ), status::ok );
+			std::vector<u8> read_record( records[inx].size() );
+			ASSERT_EQ( rs.read( read_record.data(), read_record.size() ), status::ok );
+			EXPECT_TRUE( read_record == records[inx] );
+		}
+	}
+}
+
+TEST( data_stream, tree_hash_test )
+{
+	auto data = random_vector<u8>( 5 * 1024 * 1024 + ( random_value<u32>() % 100000 ) );
+
+	// the tree hash of the streams matches the tree hash of the data
+	hasher_tree<> hasher;
+	hasher.update( data.data(), data.size() );
+	const digest<256> expected_digest = hasher.finish().value();
+
+	memory_data_destination dest;
+	if( true )
+	{
+		write_stream<memory_data_destination,hasher_tree<>> ws( dest, write_stream_flags::async_hash, 1000000 );
+		ASSERT_EQ( ws.write_bytes( data.data(), data.size() ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+		EXPECT_EQ( ws.get_digest().value(), expected_digest );
+	}
+	if( true )
+	{
+		memory_data_source source( dest.data(), dest.size() );
+		read_stream<memory_data_source,hasher_tree<>> rs( source );
+		std::vector<u8> read_data( data.size() );
+		ASSERT_EQ( rs.read_bytes( read_data.data(), read_data.size() ), status::ok );
+		EXPECT_TRUE( rs.has_ended() );
+		EXPECT_TRUE( read_data == data );
+		EXPECT_EQ( rs.get_digest().value(), expected_digest );
+	}
+}
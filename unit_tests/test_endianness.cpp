@@ -40,4 +40,60 @@ TEST( endianness, basic_test )
 	uint64_t sb64 = 0x123456789abcdef0;
 	swap_byte_order( &sb64 );
 	EXPECT_EQ( sb64, (uint64_t)0xf0debc9a78563412 );
-}
\ No newline at end of file
+}
+
+template<class _Ty> void test_copy_swap_byte_order( size_t count )
+{
+	// use an unaligned destination and source
+	std::vector<uint8_t> src( count * sizeof( _Ty ) + 1 );
+	std::vector<uint8_t> dest( count * sizeof( _Ty ) + 1 );
+	for( size_t inx = 0; inx < src.size(); ++inx )
+		src[inx] = uint8_t( inx * 7 + 3 );
+
+	copy_swap_byte_order<_Ty>( &dest[1], &src[1], count );
+	for( size_t inx = 0; inx < count; ++inx )
+	{
+		for( size_t b = 0; b < sizeof( _Ty ); ++b )
+			EXPECT_EQ( dest[1 + inx * sizeof( _Ty ) + b], src[1 + inx * sizeof( _Ty ) + ( sizeof( _Ty ) - 1 - b )] );
+	}
+
+	// swapping in place must match swapping the values one by one
+	std::vector<_Ty> values( count );
+	memcpy( values.data(), &src[1], count * sizeof( _Ty ) );
+	std::vector<_Ty> swapped = values;
+	for( size_t inx = 0; inx < count; ++inx )
+		swap_byte_order<_Ty>( &swapped[inx] );
+	std::vector<_Ty> bulk_swapped = values;
+	swap_byte_order<_Ty>( bulk_swapped.data(), count );
+	EXPECT_TRUE( bulk_swapped == swapped );
+	copy_swap_byte_order<_Ty>( values.data(), values.data(), count );
+	EXPECT_TRUE( values == swapped );
+}
+
+TEST( endianness, copy_swap_test )
+{
+	EXPECT_EQ( swapped_byte_order( (uint16_t)0x1234 ), (uint16_t)0x3412 );
+	EXPECT_EQ( swapped_byte_order( (uint32_t)0x12345678 ), (uint32_t)0x78563412 );
+	EXPECT_EQ( swapped_byte_order( (uint64_t)0x123456789abcdef0 ), (uint64_t)0xf0debc9a78563412 );
+
+	for( size_t count : { 0, 1, 2, 3, 15, 16, 17, 100, 1023 } )
+	{
+		test_copy_swap_byte_order<uint16_t>( count );
+		test_copy_swap_byte_order<uint32_t>( count );
+		test_copy_swap_byte_order<uint64_t>( count );
+	}
+
+	// single byte values are copied as is
+	const uint8_t bytes[5] = { 1, 2, 3, 4, 0xff };
+	uint8_t copied_bytes[5] = {};
+	copy_swap_byte_order<uint8_t>( copied_bytes, bytes, 5 );
+	EXPECT_EQ( memcmp( copied_bytes, bytes, 5 ), 0 );
+	const int8_t signed_bytes[3] = { -1, 2, -3 };
+	int8_t copied_signed_bytes[3] = {};
+	copy_swap_byte_order<typename byte_order_swap_type<sizeof(int8_t)>::type>( copied_signed_bytes, signed_bytes, 3 );
+	EXPECT_EQ( memcmp( copied_signed_bytes, signed_bytes, 3 ), 0 );
+	copy_swap_byte_order<int8_t>( copied_signed_bytes, copied_signed_bytes, 3 );
+	EXPECT_EQ( memcmp( copied_signed_bytes, signed_bytes, 3 ), 0 );
+	copy_bigendian<uint8_t>( copied_bytes, bytes, 5 );
+	EXPECT_EQ( memcmp( copied_bytes, bytes, 5 ), 0 );
+}
@@ -45,3 +45,318 @@ TEST( file_funcs, basic_test )
 {
 	testReadWriteAccess();
 }
+
+TEST( file_funcs, positional_read_write )
+{
+	const size_t block_size = 100000;
+	const size_t block_count = 8;
+	auto cont = random_vector<u8>( block_size * block_count );
+
+	// generate a unique local file name using a uuid
+	std::string filename = to_hex_string( uuid::generate() );
+
+	// write the blocks in reverse order, at their positions in the file
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_write( filename ), status::ok );
+		for( size_t inx = block_count; inx > 0; --inx )
+		{
+			const size_t offset = (inx-1) * block_size;
+			ASSERT_EQ( f.write_at( offset, &cont[offset], block_size ), status::ok );
+		}
+		ASSERT_EQ( f.close(), status::ok );
+	}
+
+	// the file already exists, so it can't be opened for writing without overwriting
+	if( true )
+	{
+		_file_object f;
+		EXPECT_EQ( f.open_write( filename, false ), status::already_exists );
+		EXPECT_FALSE( f.is_open() );
+	}
+
+	// read the blocks back from multiple threads at the same time, using the same file object
+	std::vector<u8> dest( cont.size() );
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_read( filename ), status::ok );
+		ASSERT_EQ( f.size(), cont.size() );
+
+		std::vector<std::thread> threads;
+		std::vector<status> results( block_count );
+		for( size_t inx = 0; inx < block_count; ++inx )
+		{
+			threads.emplace_back( [&f,&dest,&results,inx,block_size]()
+			{
+				const size_t offset = inx * block_size;
+				results[inx] = f.read_at( offset, &dest[offset], block_size );
+			} );
+		}
+		for( auto &t : threads )
+			t.join();
+		for( auto &res : results )
+			EXPECT_EQ( res, status::ok );
+
+		// reading past the end of the file fails
+		u8 past_end[2] = {};
+		EXPECT_EQ( f.read_at( cont.size()-1, past_end, 2 ), status::cant_read );
+	}
+
+	EXPECT_TRUE( cont == dest );
+}
+
+static void testFileIOBatch( bool use_io_uring )
+{
+	const size_t file_count = 200;
+	const size_t file_size = 4096 + 123;
+
+	file_io_batch batch( 32, use_io_uring );
+	if( !use_io_uring )
+	{
+		EXPECT_FALSE( batch.is_using_io_uring() );
+	}
+
+	// write the files in a batch, in two halves per file, in reverse order
+	std::vector<std::vector<u8>> contents( file_count );
+	std::vector<std::string> filenames( file_count );
+	std::vector<_file_object> files( file_count );
+	for( size_t inx = 0; inx < file_count; ++inx )
+	{
+		contents[inx] = random_vector<u8>( file_size );
+		filenames[inx] = to_hex_string( uuid::generate() );
+		ASSERT_EQ( files[inx].open_write( filenames[inx] ), status::ok );
+		batch.queue_write( files[inx], file_size / 2, &contents[inx][file_size / 2], file_size - file_size / 2 );
+		batch.queue_write( files[inx], 0, contents[inx].data(), file_size / 2 );
+	}
+	EXPECT_EQ( batch.get_operation_count(), file_count * 2 );
+	ASSERT_EQ( batch.submit(), status::ok );
+	for( auto &f : files )
+		ASSERT_EQ( f.close(), status::ok );
+
+	// read the files back in a batch, with one operation reading past the end of its file
+	std::vector<std::vector<u8>> dests( file_count, std::vector<u8>( file_size + 1 ) );
+	for( size_t inx = 0; inx < file_count; ++inx )
+	{
+		ASSERT_EQ( files[inx].open_read( filenames[inx] ), status::ok );
+		const size_t op_index = batch.queue_read( files[inx], 0, dests[inx].data(), ( inx == 7 ) ? file_size + 1 : file_size );
+		EXPECT_EQ( op_index, inx );
+		EXPECT_EQ( batch.get_status( op_index ), status::not_ready );
+	}
+	EXPECT_EQ( batch.get_operation_count(), file_count );
+	EXPECT_EQ( batch.submit(), status::cant_read );
+	for( size_t inx = 0; inx < file_count; ++inx )
+	{
+		if( inx == 7 )
+		{
+			EXPECT_EQ( batch.get_status( inx ), status::cant_read );
+			continue;
+		}
+		EXPECT_EQ( batch.get_status( inx ), status::ok );
+		EXPECT_TRUE( memcmp( dests[inx].data(), contents[inx].data(), file_size ) == 0 );
+	}
+
+	// the batch can be reused after a failed submit, and started without waiting
+	for( size_t inx = 0; inx < file_count; ++inx )
+		batch.queue_read( files[inx], 0, dests[inx].data(), file_size );
+	EXPECT_EQ( batch.start(), status::ok );
+	EXPECT_EQ( batch.start(), status::invalid_param );
+	EXPECT_EQ( batch.wait(), status::ok );
+	for( size_t inx = 0; inx < file_count; ++inx )
+	{
+		EXPECT_EQ( batch.get_status( inx ), status::ok );
+		EXPECT_TRUE( memcmp( dests[inx].data(), contents[inx].data(), file_size ) == 0 );
+	}
+
+	for( size_t inx = 0; inx < file_count; ++inx )
+	{
+		EXPECT_EQ( files[inx].close(), status::ok );
+		std::remove( filenames[inx].c_str() );
+	}
+}
+
+TEST( file_funcs, file_io_batch )
+{
+	testFileIOBatch( true );
+	testFileIOBatch( false );
+}
+
+TEST( file_funcs, read_files )
+{
+	const size_t file_count = 300;
+
+	// write files of varying sizes, including empty files
+	std::vector<std::string> filenames( file_count );
+	std::vector<std::vector<u8>> contents( file_count );
+	for( size_t inx = 0; inx < file_count; ++inx )
+	{
+		filenames[inx] = to_hex_string( uuid::generate() );
+		contents[inx] = random_vector<u8>( ( inx % 10 == 0 ) ? 0 : random_value<size_t>() % 20000 );
+		ASSERT_EQ( write_file( filenames[inx], contents[inx] ), status::ok );
+	}
+
+	// read all files, with different thread counts
+	for( size_t thread_count : { 0, 1, 4 } )
+	{
+		std::vector<std::vector<u8>> dest;
+		std::vector<status> file_status;
+		ASSERT_EQ( read_files( filenames, dest, file_status, thread_count ), status::ok );
+		ASSERT_EQ( dest.size(), file_count );
+		ASSERT_EQ( file_status.size(), file_count );
+		for( size_t inx = 0; inx < file_count; ++inx )
+		{
+			EXPECT_EQ( file_status[inx], status::ok );
+			EXPECT_TRUE( dest[inx] == contents[inx] );
+		}
+	}
+
+	// a missing file is reported in its status, the other files are still read
+	std::vector<std::string> missing_filenames = filenames;
+	missing_filenames[123] = to_hex_string( uuid::generate() );
+	std::vector<std::vector<u8>> dest;
+	std::vector<status> file_status;
+	EXPECT_EQ( read_files( missing_filenames, dest, file_status, 3 ), status::cant_open );
+	EXPECT_EQ( file_status[123], status::cant_open );
+	EXPECT_EQ( file_status[122], status::ok );
+	EXPECT_TRUE( dest[124] == contents[124] );
+	EXPECT_EQ( read_files( missing_filenames, dest ), status::cant_open );
+
+	for( auto &filename : filenames )
+		std::remove( filename.c_str() );
+}
+
+TEST( file_funcs, unbuffered_read_write )
+{
+	const size_t alignment = _file_object::unbuffered_alignment;
+	const size_t aligned_size = 64 * alignment;
+	const size_t file_size = aligned_size + 1234;
+	auto cont = random_vector<u8>( file_size );
+
+	// aligned copies of the data, and a destination buffer
+	std::vector<u8> src_mem( file_size + alignment );
+	std::vector<u8> dest_mem( file_size + alignment );
+	u8 *src = (u8*)( ( (uintptr_t)src_mem.data() + alignment - 1 ) & ~(uintptr_t)( alignment - 1 ) );
+	u8 *dest = (u8*)( ( (uintptr_t)dest_mem.data() + alignment - 1 ) & ~(uintptr_t)( alignment - 1 ) );
+	memcpy( src, cont.data(), file_size );
+
+	std::string filename = to_hex_string( uuid::generate() );
+
+	// write the aligned part unbuffered (if the file system supports it), the unaligned tail switches the file to buffered mode
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_write( filename, false, true ), status::ok );
+		const bool unbuffered = f.is_unbuffered();
+		ASSERT_EQ( f.write( src, aligned_size / 2 ), status::ok );
+		ASSERT_EQ( f.write_at( aligned_size / 2, &src[aligned_size / 2], aligned_size / 2 ), status::ok );
+		EXPECT_EQ( f.is_unbuffered(), unbuffered );
+		ASSERT_EQ( f.write_at( aligned_size, &src[aligned_size], file_size - aligned_size ), status::ok );
+		EXPECT_FALSE( f.is_unbuffered() );
+		ASSERT_EQ( f.close(), status::ok );
+	}
+
+	// read the file back unbuffered, the last block is read with an unaligned size
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_read( filename, true ), status::ok );
+		ASSERT_EQ( f.size(), file_size );
+		const bool unbuffered = f.is_unbuffered();
+		ASSERT_EQ( f.read_at( alignment, &dest[alignment], aligned_size - alignment ), status::ok );
+		ASSERT_EQ( f.read( dest, alignment ), status::ok );
+		EXPECT_EQ( f.is_unbuffered(), unbuffered );
+		ASSERT_EQ( f.read_at( aligned_size, &dest[aligned_size], file_size - aligned_size ), status::ok );
+		EXPECT_FALSE( f.is_unbuffered() );
+		EXPECT_TRUE( memcmp( dest, cont.data(), file_size ) == 0 );
+
+		// reading past the end of the file still fails
+		EXPECT_EQ( f.read_at( 0, dest, file_size + 1 ), status::cant_read );
+		ASSERT_EQ( f.close(), status::ok );
+	}
+
+	std::remove( filename.c_str() );
+
+#if defined(__linux__)
+	// procfs and character devices reject O_DIRECT, so these files fall back to buffered mode
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_read( "/proc/self/status", true ), status::ok );
+		EXPECT_FALSE( f.is_unbuffered() );
+		ASSERT_EQ( f.close(), status::ok );
+		ASSERT_EQ( f.open_write( "/dev/null", true, true ), status::ok );
+		EXPECT_FALSE( f.is_unbuffered() );
+		EXPECT_EQ( f.write( src, aligned_size ), status::ok );
+		ASSERT_EQ( f.close(), status::ok );
+	}
+#endif
+}
+
+TEST( file_funcs, atomic_write )
+{
+	std::string filename = to_hex_string( uuid::generate() );
+	auto first = random_vector<u8>( 100000 );
+	auto second = random_vector<u8>( 50000 );
+	std::vector<u8> dest;
+
+	// write a new file atomically
+	ASSERT_EQ( write_file( filename, first, false, true ), status::ok );
+	ASSERT_EQ( read_file( filename, dest ), status::ok );
+	EXPECT_TRUE( dest == first );
+
+	// the file exists, so it is not replaced unless overwriting
+	EXPECT_EQ( write_file( filename, second, false, true ), status::already_exists );
+
+	// the file is not changed until the atomic write is closed
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_write_atomic( filename, true ), status::ok );
+		ASSERT_EQ( f.preallocate( second.size() ), status::ok );
+		ASSERT_EQ( f.write( second.data(), second.size() ), status::ok );
+		ASSERT_EQ( read_file( filename, dest ), status::ok );
+		EXPECT_TRUE( dest == first );
+		ASSERT_EQ( f.close(), status::ok );
+		ASSERT_EQ( read_file( filename, dest ), status::ok );
+		EXPECT_TRUE( dest == second );
+	}
+
+	// an atomic write which is not closed is discarded
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_write_atomic( filename, true ), status::ok );
+		ASSERT_EQ( f.write( first.data(), first.size() ), status::ok );
+	}
+	ASSERT_EQ( read_file( filename, dest ), status::ok );
+	EXPECT_TRUE( dest == second );
+
+	// if the file is created while an atomic write is open, the write does not replace it unless overwriting
+	std::string new_filename = to_hex_string( uuid::generate() );
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_write_atomic( new_filename, false ), status::ok );
+		ASSERT_EQ( f.write( first.data(), first.size() ), status::ok );
+		ASSERT_EQ( write_file( new_filename, second ), status::ok );
+		EXPECT_EQ( f.close(), status::already_exists );
+	}
+	ASSERT_EQ( read_file( new_filename, dest ), status::ok );
+	EXPECT_TRUE( dest == second );
+
+	// preallocation does not change the size of the file
+	if( true )
+	{
+		_file_object f;
+		ASSERT_EQ( f.open_write( new_filename, true ), status::ok );
+		ASSERT_EQ( f.preallocate( 1024 * 1024 ), status::ok );
+		ASSERT_EQ( f.write( first.data(), 1000 ), status::ok );
+		ASSERT_EQ( f.close(), status::ok );
+	}
+	ASSERT_EQ( read_file( new_filename, dest ), status::ok );
+	EXPECT_EQ( dest.size(), 1000 );
+
+	std::remove( filename.c_str() );
+	std::remove( new_filename.c_str() );
+}
@@ -2,6 +2,8 @@
 // Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
 
 #include <ctle/hasher.h>
+#include <ctle/hasher_tree.h>
+#include <ctle/file_funcs.h>
 #include <ctle/string_funcs.h>
 
 #include "unit_tests.h"
@@ -42,6 +44,7 @@ void test_expected_hash( const u8 *srcdata, size_t size, const char *expected_ha
 TEST( hasher, test_expected_hash_values )
 {
 	test_expected_hash<hasher_sha256>(hashing_testdata,sizeof(hashing_testdata),"0A2591AAF3340AD92FAECBC5908E74D04B51EE5D2DEEE78F089F1607570E2E91");
+	test_expected_hash<hasher_sha256_native>(hashing_testdata,sizeof(hashing_testdata),"0A2591AAF3340AD92FAECBC5908E74D04B51EE5D2DEEE78F089F1607570E2E91");
 	test_expected_hash<hasher_xxh64>(hashing_testdata,sizeof(hashing_testdata),"625A8B25C833FD36");
 	test_expected_hash<hasher_xxh128>(hashing_testdata,sizeof(hashing_testdata),"828D13C68D1BAC3AA5AA63C0925F9C1E");
 	test_expected_hash<hasher_2x_xxh128_dcb7be9cd0fcf505>(hashing_testdata,sizeof(hashing_testdata),"828D13C68D1BAC3AA5AA63C0925F9C1EEA0301A0F7F3CE81062211DDAAD62522");
@@ -88,7 +91,226 @@ TEST( hasher, test_determenism )
 	const size_t block_size2 = (size_t)random_value<u16>() + 100;
 
 	test_hash_determenism<hasher_sha256>( random_data.data(), random_data.size(), block_size1, block_size2 );
+	test_hash_determenism<hasher_sha256_native>( random_data.data(), random_data.size(), block_size1, block_size2 );
 	test_hash_determenism<hasher_xxh64>( random_data.data(), random_data.size(), block_size1, block_size2 );
 	test_hash_determenism<hasher_xxh128>( random_data.data(), random_data.size(), block_size1, block_size2 );
 	test_hash_determenism<hasher_2x_xxh128_dcb7be9cd0fcf505>( random_data.data(), random_data.size(), block_size1, block_size2 );
 }
+
+template<class _Ty>
+void test_hash_reset( const u8 *srcdata, size_t size )
+{
+	_Ty hasher;
+
+	// hash some other data, reset, and hash the data, which should match the hash of a new hasher
+	hasher.update( srcdata, size / 3 );
+	hasher.reset();
+	hasher.update( srcdata, size );
+	auto hash1 = hasher.finish().value();
+
+	// reuse the hasher after finish
+	hasher.reset();
+	hasher.update( srcdata, size );
+	auto hash2 = hasher.finish().value();
+
+	_Ty new_hasher;
+	new_hasher.update( srcdata, size );
+	auto expected_hash = new_hasher.finish().value();
+
+	EXPECT_EQ( hash1, expected_hash );
+	EXPECT_EQ( hash2, expected_hash );
+}
+
+TEST( hasher, reset )
+{
+	std::vector<u8> random_data( 100000 + (size_t)random_value<u16>() );
+	for( auto &val : random_data )
+		val = random_value<u8>();
+
+	test_hash_reset<hasher_sha256>( random_data.data(), random_data.size() );
+	test_hash_reset<hasher_sha256_native>( random_data.data(), random_data.size() );
+	test_hash_reset<hasher_xxh64>( random_data.data(), random_data.size() );
+	test_hash_reset<hasher_xxh128>( random_data.data(), random_data.size() );
+	test_hash_reset<hasher_2x_xxh128_dcb7be9cd0fcf505>( random_data.data(), random_data.size() );
+	test_hash_reset<hasher_noop<256>>( random_data.data(), random_data.size() );
+	test_hash_reset<hasher_tree<>>( random_data.data(), random_data.size() );
+
+	// the xxh hashers keep the state in the object, which is aligned within the object
+	std::unique_ptr<hasher_xxh128> heap_hasher( new hasher_xxh128() );
+	heap_hasher->update( hashing_testdata, sizeof(hashing_testdata) );
+	EXPECT_EQ( heap_hasher->finish().value(), from_string<digest<128>>( "828D13C68D1BAC3AA5AA63C0925F9C1E" ) );
+}
+
+TEST( hasher, sha256_native )
+{
+	// the native hasher, with and without cpu extensions, matches picosha2 for all sizes around the block and padding boundaries
+	auto data = random_vector<u8>( 1000 );
+	for( size_t size = 0; size < 300; ++size )
+	{
+		hasher_sha256 reference;
+		hasher_sha256_native native;
+		hasher_sha256_native scalar( false );
+		reference.update( data.data(), size );
+		native.update( data.data(), size );
+		scalar.update( data.data() + 0, size / 3 );
+		scalar.update( data.data() + size / 3, size - size / 3 );
+		const auto reference_digest = reference.finish().value();
+		EXPECT_EQ( native.finish().value(), reference_digest );
+		EXPECT_EQ( scalar.finish().value(), reference_digest );
+	}
+
+	// and for a larger input, which is compressed in bulk
+	auto large_data = random_vector<u8>( 1024 * 1024 + 17 );
+	hasher_sha256 large_reference;
+	hasher_sha256_native large_native;
+	hasher_sha256_native large_scalar( false );
+	large_reference.update( large_data.data(), large_data.size() );
+	large_native.update( large_data.data(), large_data.size() );
+	large_scalar.update( large_data.data(), large_data.size() );
+	const auto large_reference_digest = large_reference.finish().value();
+	EXPECT_EQ( large_native.finish().value(), large_reference_digest );
+	EXPECT_EQ( large_scalar.finish().value(), large_reference_digest );
+
+	// known values
+	hasher_sha256_native empty;
+	EXPECT_EQ( empty.finish().value(), from_string<digest<256>>( "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855" ) );
+	hasher_sha256_native abc( false );
+	abc.update( (const u8*)"abc", 3 );
+	EXPECT_EQ( abc.finish().value(), from_string<digest<256>>( "BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD" ) );
+	EXPECT_STREQ( hasher_sha256_native( false ).get_implementation(), "scalar" );
+}
+
+template<class _Ty> static void test_hash_once( const std::vector<u8> &data )
+{
+	// all sizes around the block sizes of the hashers
+	for( size_t size = 0; size <= 300; ++size )
+	{
+		_Ty hasher;
+		hasher.update( data.data(), size );
+		auto expected_hash = hasher.finish().value();
+		EXPECT_EQ( hash_once<_Ty>( data.data(), size ), expected_hash );
+	}
+
+	_Ty hasher;
+	hasher.update( data.data(), data.size() );
+	auto expected_hash = hasher.finish().value();
+	EXPECT_EQ( hash_once<_Ty>( data.data(), data.size() ), expected_hash );
+}
+
+TEST( hasher, hash_once )
+{
+	auto data = random_vector<u8>( 10000 + ( random_value<u32>() % 10000 ) );
+
+	test_hash_once<hasher_sha256>( data );
+	test_hash_once<hasher_sha256_native>( data );
+	test_hash_once<hasher_xxh64>( data );
+	test_hash_once<hasher_xxh128>( data );
+	test_hash_once<hasher_2x_xxh128_dcb7be9cd0fcf505>( data );
+	test_hash_once<hasher_noop<64>>( data );
+
+	EXPECT_EQ( hash_once<hasher_sha256_native>( nullptr, 0 ), from_string<digest<256>>( "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855" ) );
+	EXPECT_EQ( hash_once<hasher_xxh128>( hashing_testdata, sizeof(hashing_testdata) ), from_string<digest<128>>( "828D13C68D1BAC3AA5AA63C0925F9C1E" ) );
+}
+
+template<class _Ty> static void test_hash_batch( const std::vector<write_span> &spans )
+{
+	std::vector<typename _Ty::hash_type> digests( spans.size() );
+	EXPECT_EQ( hash_batch<_Ty>( spans.data(), spans.size(), digests.data() ), status::ok );
+	for( size_t inx = 0; inx < spans.size(); ++inx )
+	{
+		_Ty hasher;
+		hasher.update( (const u8*)spans[inx].data, spans[inx].size );
+		EXPECT_EQ( digests[inx], hasher.finish().value() );
+	}
+}
+
+TEST( hasher, hash_batch )
+{
+	// buffers of random sizes, including empty buffers
+	auto data = random_vector<u8>( 100000 );
+	std::vector<write_span> spans;
+	size_t offset = 0;
+	while( offset < data.size() )
+	{
+		const size_t size = std::min( (size_t)( random_value<u32>() % 600 ), data.size() - offset );
+		spans.push_back( { &data[offset], size } );
+		offset += size;
+	}
+
+	test_hash_batch<hasher_sha256>( spans );
+	test_hash_batch<hasher_sha256_native>( spans );
+	test_hash_batch<hasher_xxh64>( spans );
+	test_hash_batch<hasher_xxh128>( spans );
+	test_hash_batch<hasher_2x_xxh128_dcb7be9cd0fcf505>( spans );
+	test_hash_batch<hasher_noop<128>>( spans );
+
+	// the multi-buffer SHA-256 path (which is only selected if the CPU has AVX2 but not the SHA extensions), with messages around 
+	// the padding boundaries and of very different sizes, so the lanes are refilled at different times
+	const size_t message_sizes[] = { 0, 1, 55, 56, 63, 64, 65, 119, 120, 127, 128, 5000, 3, 200, 64*70, 0, 17, 1000 };
+	const size_t message_count = sizeof(message_sizes) / sizeof(message_sizes[0]);
+	std::vector<const u8*> message_data( message_count );
+	std::vector<digest<256>> message_digests( message_count );
+	for( size_t inx = 0; inx < message_count; ++inx )
+		message_data[inx] = &data[inx * 100];
+	_sha256_hash_many( message_data.data(), message_sizes, message_count, message_digests.data(), false );
+	for( size_t inx = 0; inx < message_count; ++inx )
+	{
+		hasher_sha256 hasher;
+		hasher.update( message_data[inx], message_sizes[inx] );
+		EXPECT_EQ( message_digests[inx], hasher.finish().value() );
+	}
+
+	// an empty batch is valid, but missing inputs are not
+	digest<128> out;
+	EXPECT_EQ( hash_batch<hasher_xxh128>( (const write_span*)nullptr, 0, &out ), status::ok );
+	EXPECT_EQ( hash_batch<hasher_xxh128>( (const write_span*)nullptr, 1, &out ), status::invalid_param );
+}
+
+TEST( hasher, hasher_tree )
+{
+	const size_t leaf_size = 1000;
+	auto data = random_vector<u8>( 100000 + ( random_value<u32>() % 100000 ) );
+
+	// the leaves and root match a manual calculation
+	const size_t leaf_count = ( data.size() + leaf_size - 1 ) / leaf_size;
+	std::vector<digest<256>> expected_leaves;
+	for( size_t inx = 0; inx < leaf_count; ++inx )
+		expected_leaves.push_back( hasher_tree<>::hash_leaf( &data[inx * leaf_size], std::min( leaf_size, data.size() - inx * leaf_size ) ) );
+	const digest<256> expected_root = hasher_tree<>::hash_root( expected_leaves.data(), expected_leaves.size() );
+
+	// the root does not depend on the update sizes or the number of threads
+	for( size_t thread_count : { 0, 1, 3 } )
+	{
+		hasher_tree<> hasher( leaf_size, thread_count );
+		size_t offset = 0;
+		while( offset < data.size() )
+		{
+			const size_t size = std::min( (size_t)( random_value<u32>() % 5000 ), data.size() - offset );
+			EXPECT_EQ( hasher.update( &data[offset], size ), status::ok );
+			offset += size;
+		}
+		EXPECT_EQ( hasher.finish().value(), expected_root );
+		EXPECT_TRUE( hasher.get_leaf_digests() == expected_leaves );
+	}
+
+	// a range of the data can be verified using the leaf hashes
+	hasher_tree<hasher_sha256> reference( leaf_size );
+	reference.update( data.data(), data.size() );
+	EXPECT_EQ( reference.finish().value(), expected_root );
+	EXPECT_EQ( hasher_tree<>::hash_leaf( &data[5 * leaf_size], leaf_size ), reference.get_leaf_digests()[5] );
+
+	// an input which is a multiple of the leaf size has no empty last leaf, and an empty input has a single empty leaf
+	hasher_tree<> exact( leaf_size );
+	exact.update( data.data(), 3 * leaf_size );
+	exact.finish();
+	EXPECT_EQ( exact.get_leaf_digests().size(), 3 );
+	hasher_tree<> empty;
+	EXPECT_EQ( empty.finish().value(), hasher_tree<>::hash_leaf( nullptr, 0 ) );
+
+	// a tree with other leaf hashers
+	hasher_tree<hasher_2x_xxh128_dcb7be9cd0fcf505> xxh_tree( leaf_size );
+	xxh_tree.update( data.data(), data.size() );
+	const digest<256> xxh_root = xxh_tree.finish().value();
+	EXPECT_EQ( xxh_root, hasher_tree<hasher_2x_xxh128_dcb7be9cd0fcf505>::hash_root( xxh_tree.get_leaf_digests().data(), leaf_count ) );
+	EXPECT_NE( xxh_tree.get_leaf_digests()[0], expected_leaves[0] );
+}
@@ -2,6 +2,8 @@
 // Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
 
 #include <ctle/sockets.h>
+#include <ctle/read_stream.h>
+#include <ctle/write_stream.h>
 
 #include "unit_tests.h"
 
@@ -82,3 +84,58 @@ TEST( sockets, basic_server_test )
 	// wait for server to stop, give it 3 seconds
 	ASSERT_TRUE( run_function_with_timeout( []() { return basic_server_socket->get_server_state() == ctle::server_socket::server_state::stopped; }, 3000 ) );
 }
+
+TEST( sockets, socket_stream_test )
+{
+	const uint16_t port = 13585;
+	const std::vector<u64> values = random_vector<u64>( 1000000 + (random_value<u32>() % 1000) );
+	const u64 payload_size = values.size() * sizeof(u64);
+
+	// the server receives and hashes the payload, and sends back the payload digest
+	server_socket server;
+	auto server_fut = std::async( std::launch::async, [&]() 
+		{
+			return server.start(port, [&]( stream_socket incoming ) -> status
+				{
+					socket_data_source ds(incoming, payload_size);
+					read_stream<socket_data_source,hasher_xxh128> rs(ds, read_stream_flags::async_read, 64 * 1024);
+					std::vector<u64> received( values.size() );
+					ctle::status result = rs.read( received.data(), received.size() );
+					if( !result )
+						return result;
+					if( !rs.has_ended() || received != values )
+						return status::corrupted;
+
+					socket_data_destination dd(incoming);
+					write_stream<socket_data_destination> ws(dd);
+					ws.write( rs.get_digest().value() );
+					return ws.end();
+				}
+			);
+		} 
+	);
+	ASSERT_TRUE( run_function_with_timeout( [&]() { return server.get_server_state() == ctle::server_socket::server_state::running; }, 3000 ) );
+
+	// send the payload using small buffers, so that there are many partial sends and receives
+	auto connection = stream_socket::connect("",port);
+	ASSERT_EQ( connection.status(), status::ok );
+	digest<128> sent_digest;
+	if( true )
+	{
+		socket_data_destination dd(*connection.value());
+		write_stream<socket_data_destination,hasher_xxh128> ws(dd, write_stream_flags::async_write, 1000);
+		ASSERT_EQ( ws.write( values.data(), values.size() ), status::ok );
+		ASSERT_EQ( ws.end(), status::ok );
+		sent_digest = ws.get_digest().value();
+		EXPECT_EQ( dd.get_position(), payload_size );
+	}
+
+	// receive the digest which the server calculated
+	socket_data_source ds(*connection.value(), sizeof(digest<128>));
+	read_stream<socket_data_source> rs(ds);
+	EXPECT_EQ( rs.read<digest<128>>(), sent_digest );
+	EXPECT_TRUE( rs.has_ended() );
+
+	ASSERT_EQ( server.stop(), status::ok );
+	ASSERT_TRUE( run_function_with_timeout( [&]() { return server.get_server_state() == ctle::server_socket::server_state::stopped; }, 3000 ) );
+}
@@ -0,0 +1,55 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+
+#include "unit_tests.h"
+
+#include <ctle/task_worker.h>
+
+#include <vector>
+
+using namespace ctle;
+
+TEST( task_worker, basic_test )
+{
+	task_worker worker;
+
+	// nothing submitted, nothing to wait for
+	EXPECT_EQ( worker.wait(), status::ok );
+
+	// the tasks run in submission order, on a single thread which is reused
+	std::vector<size_t> order;
+	std::vector<std::thread::id> thread_ids;
+	for( size_t inx = 0; inx < 100; ++inx )
+	{
+		worker.submit( [&order,&thread_ids,inx]() { order.push_back( inx ); thread_ids.push_back( std::this_thread::get_id() ); return status(status::ok); } );
+		if( inx % 10 == 0 )
+		{
+			EXPECT_EQ( worker.wait(), status::ok );
+		}
+	}
+	EXPECT_EQ( worker.wait(), status::ok );
+	ASSERT_EQ( order.size(), 100 );
+	for( size_t inx = 0; inx < order.size(); ++inx )
+	{
+		EXPECT_EQ( order[inx], inx );
+		EXPECT_EQ( thread_ids[inx], thread_ids[0] );
+	}
+	EXPECT_NE( thread_ids[0], std::this_thread::get_id() );
+
+	// the first error is returned from wait, and is cleared by it
+	worker.submit( []() { return status(status::ok); } );
+	worker.submit( []() { return status(status::cant_write); } );
+	worker.submit( []() { return status(status::cant_read); } );
+	EXPECT_EQ( worker.wait(), status::cant_write );
+	EXPECT_EQ( worker.wait(), status::ok );
+
+	// queued tasks are run before the worker is destroyed
+	size_t count = 0;
+	if( true )
+	{
+		task_worker scoped_worker;
+		for( size_t inx = 0; inx < 10; ++inx )
+			scoped_worker.submit( [&count]() { ++count; return status(status::ok); } );
+	}
+	EXPECT_EQ( count, 10 );
+}
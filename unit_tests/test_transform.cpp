@@ -0,0 +1,86 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+
+#include <ctle/transform.h>
+
+#include "unit_tests.h"
+
+using namespace ctle;
+
+// generates data which is compressible, with runs of repeated text, repeated earlier parts, and random bytes
+static std::vector<u8> compressible_data( size_t size )
+{
+	static const char text[] = "The quick brown fox jumps over the lazy dog. ";
+	std::vector<u8> data( size );
+	size_t pos = 0;
+	while( pos < size )
+	{
+		const size_t run = std::min( (size_t)( random_value<u32>() % 300 ) + 1, size - pos );
+		const u32 kind = random_value<u32>() % 3;
+		for( size_t inx = 0; inx < run; ++inx )
+		{
+			if( kind == 0 )
+				data[pos + inx] = (u8)text[( pos + inx ) % ( sizeof( text ) - 1 )];
+			else if( kind == 1 && pos > 1000 )
+				data[pos + inx] = data[pos + inx - 1000];
+			else
+				data[pos + inx] = random_value<u8>();
+		}
+		pos += run;
+	}
+	return data;
+}
+
+template<class _TransformTy> static void test_transform_roundtrip( _TransformTy &transform, const std::vector<u8> &data )
+{
+	std::vector<u8> encoded( transform.max_encoded_size( data.size() ) );
+	auto encode_result = transform.encode( data.data(), data.size(), encoded.data(), encoded.size() );
+	ASSERT_EQ( encode_result.status(), status::ok );
+	ASSERT_LE( encode_result.value(), transform.max_encoded_size( data.size() ) );
+
+	std::vector<u8> decoded( data.size() );
+	auto decode_result = transform.decode( encoded.data(), encode_result.value(), decoded.data(), decoded.size() );
+	ASSERT_EQ( decode_result.status(), status::ok );
+	EXPECT_EQ( decode_result.value(), data.size() );
+	EXPECT_TRUE( decoded == data );
+}
+
+TEST( transform, lz_test )
+{
+	transform_lz transform;
+
+	// empty, tiny, incompressible and compressible data
+	test_transform_roundtrip( transform, std::vector<u8>() );
+	test_transform_roundtrip( transform, std::vector<u8>( 1, 0x55 ) );
+	test_transform_roundtrip( transform, std::vector<u8>( 100000, 0x00 ) );
+	test_transform_roundtrip( transform, random_vector<u8>( 100000 ) );
+	for( size_t inx = 0; inx < 10; ++inx )
+		test_transform_roundtrip( transform, compressible_data( random_value<u32>() % 500000 ) );
+
+	// compressible data must get smaller
+	auto data = compressible_data( 1000000 );
+	std::vector<u8> encoded( transform.max_encoded_size( data.size() ) );
+	auto encoded_size = transform.encode( data.data(), data.size(), encoded.data(), encoded.size() ).value();
+	EXPECT_LT( encoded_size, data.size() * 3 / 4 );
+
+	// corrupted data must be detected, and never write outside the destination
+	std::vector<u8> decoded( data.size() );
+	EXPECT_EQ( transform.decode( encoded.data(), encoded_size / 2, decoded.data(), decoded.size() ).status(), status::corrupted );
+	EXPECT_EQ( transform.decode( encoded.data(), encoded_size, decoded.data(), decoded.size() / 2 ).status(), status::corrupted );
+	for( size_t inx = 0; inx < 100; ++inx )
+	{
+		std::vector<u8> damaged( encoded.begin(), encoded.begin() + encoded_size );
+		damaged[random_value<u32>() % encoded_size] = random_value<u8>();
+		auto result = transform.decode( damaged.data(), damaged.size(), decoded.data(), decoded.size() );
+		EXPECT_TRUE( result.status() == status::corrupted || result.value() <= decoded.size() );
+	}
+}
+
+#ifdef ZSTD_H_235446
+TEST( transform, zstd_test )
+{
+	transform_zstd transform;
+	test_transform_roundtrip( transform, random_vector<u8>( 100000 ) );
+	test_transform_roundtrip( transform, compressible_data( 1000000 ) );
+}
+#endif//ZSTD_H_235446
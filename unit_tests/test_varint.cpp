@@ -0,0 +1,112 @@
+// ctle Copyright (c) 2024 Ulrik Lindahl
+// Licensed under the MIT license https://github.com/Cooolrik/ctle/blob/main/LICENSE
+
+#include <ctle/varint.h>
+
+#include "unit_tests.h"
+
+#include <limits>
+
+using namespace ctle;
+
+template<class _Ty> void test_varint_value( _Ty value )
+{
+	u8 encoded[varint_max_size<_Ty>::value + 1] = {};
+	const size_t size = varint_encode( encoded, value );
+	EXPECT_GE( size, (size_t)1 );
+	EXPECT_LE( size, varint_max_size<_Ty>::value );
+
+	_Ty decoded = {};
+	EXPECT_EQ( varint_decode( encoded, size, &decoded ), size );
+	EXPECT_EQ( decoded, value );
+
+	// a truncated value can not be decoded
+	EXPECT_EQ( varint_decode( encoded, size - 1, &decoded ), (size_t)0 );
+}
+
+template<class _Ty> void test_varint_type()
+{
+	test_varint_value<_Ty>( 0 );
+	test_varint_value<_Ty>( 1 );
+	test_varint_value<_Ty>( 63 );
+	test_varint_value<_Ty>( 64 );
+	test_varint_value<_Ty>( 127 );
+	test_varint_value<_Ty>( std::numeric_limits<_Ty>::min() );
+	test_varint_value<_Ty>( std::numeric_limits<_Ty>::max() );
+	for( size_t inx = 0; inx < 1000; ++inx )
+		test_varint_value<_Ty>( random_value<_Ty>() );
+
+	// bulk encode and decode a mix of small and random values
+	std::vector<_Ty> values( 1000 );
+	for( size_t inx = 0; inx < values.size(); ++inx )
+		values[inx] = ( inx % 10 == 0 ) ? random_value<_Ty>() : _Ty( inx % 50 );
+	std::vector<u8> encoded( values.size() * varint_max_size<_Ty>::value );
+	const size_t encoded_size = varint_encode( encoded.data(), values.data(), values.size() );
+
+	std::vector<_Ty> decoded( values.size() );
+	size_t decoded_count = 0;
+	EXPECT_EQ( varint_decode( encoded.data(), encoded_size, decoded.data(), decoded.size(), &decoded_count ), encoded_size );
+	EXPECT_EQ( decoded_count, values.size() );
+	EXPECT_TRUE( decoded == values );
+
+	// decoding a truncated buffer stops before the incomplete value
+	const size_t partial_size = varint_decode( encoded.data(), encoded_size / 2, decoded.data(), decoded.size(), &decoded_count );
+	EXPECT_LE( partial_size, encoded_size / 2 );
+	EXPECT_LT( decoded_count, values.size() );
+	EXPECT_EQ( varint_encode( encoded.data(), values.data(), decoded_count ), partial_size );
+}
+
+TEST( varint, basic_test )
+{
+	EXPECT_EQ( varint_max_size<u8>::value, (size_t)2 );
+	EXPECT_EQ( varint_max_size<u16>::value, (size_t)3 );
+	EXPECT_EQ( varint_max_size<u32>::value, (size_t)5 );
+	EXPECT_EQ( varint_max_size<u64>::value, (size_t)10 );
+
+	// zigzag maps 0, -1, 1, -2, 2 to 0, 1, 2, 3, 4
+	EXPECT_EQ( zigzag_encode<i32>( 0 ), (u32)0 );
+	EXPECT_EQ( zigzag_encode<i32>( -1 ), (u32)1 );
+	EXPECT_EQ( zigzag_encode<i32>( 1 ), (u32)2 );
+	EXPECT_EQ( zigzag_encode<i32>( -2 ), (u32)3 );
+	EXPECT_EQ( zigzag_encode<i64>( std::numeric_limits<i64>::min() ), std::numeric_limits<u64>::max() );
+	EXPECT_EQ( zigzag_decode<u32>( 3 ), -2 );
+	EXPECT_EQ( zigzag_decode<u64>( std::numeric_limits<u64>::max() ), std::numeric_limits<i64>::min() );
+
+	// known encodings
+	u8 encoded[10] = {};
+	EXPECT_EQ( varint_encode<u32>( encoded, 300 ), (size_t)2 );
+	EXPECT_EQ( encoded[0], 0xac );
+	EXPECT_EQ( encoded[1], 0x02 );
+	EXPECT_EQ( varint_encode<i32>( encoded, -64 ), (size_t)1 );
+	EXPECT_EQ( encoded[0], 0x7f );
+
+	test_varint_type<u8>();
+	test_varint_type<i8>();
+	test_varint_type<u16>();
+	test_varint_type<i16>();
+	test_varint_type<u32>();
+	test_varint_type<i32>();
+	test_varint_type<u64>();
+	test_varint_type<i64>();
+}
+
+TEST( varint, invalid_test )
+{
+	// values which are out of range for the type, or too long
+	const u8 too_large_u8[] = { 0xff, 0x02 };
+	const u8 too_large_u32[] = { 0xff, 0xff, 0xff, 0xff, 0x10 };
+	const u8 too_long_u32[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+	const u8 too_long_u64[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+	u8 value8 = 0;
+	u32 value32 = 0;
+	u64 value64 = 0;
+	EXPECT_EQ( varint_decode( too_large_u8, sizeof( too_large_u8 ), &value8 ), (size_t)0 );
+	EXPECT_EQ( varint_decode( too_large_u32, sizeof( too_large_u32 ), &value32 ), (size_t)0 );
+	EXPECT_EQ( varint_decode( too_long_u32, sizeof( too_long_u32 ), &value32 ), (size_t)0 );
+	EXPECT_EQ( varint_decode( too_long_u64, sizeof( too_long_u64 ), &value64 ), (size_t)0 );
+
+	// the max values are valid
+	const u8 max_u32[] = { 0xff, 0xff, 0xff, 0xff, 0x0f };
+	EXPECT_EQ( varint_decode( max_u32, sizeof( max_u32 ), &value32 ), (size_t)5 );
+	EXPECT_EQ( value32, std::numeric_limits<u32>::max() );
+}
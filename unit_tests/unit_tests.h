@@ -24,6 +24,9 @@
 
 #include <gtest/gtest.h>
 #include <picosha2.h>
+#ifndef XXH_STATIC_LINKING_ONLY
+#define XXH_STATIC_LINKING_ONLY
+#endif
 #include <xxhash.h>
 #include <functional>
 
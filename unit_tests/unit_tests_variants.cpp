@@ -15,7 +15,7 @@
 template<class _Ty> ctle::status _read_from_stream( ctle::read_stream<ctle::file_data_source,ctle::hasher_xxh128> &strm, std::vector<_Ty> &data )
 {
 	u32 cnt = 0;
-	ctle::status res = strm.read<u32>( &cnt, 1 );
+	ctle::status res = strm.read_varint<u32>( &cnt, 1 );
 	if( !res ) 
   		return res; 
 	data.resize(cnt);
@@ -24,7 +24,7 @@ template<class _Ty> ctle::status _read_from_stream( ctle::read_stream<ctle::file
 		
 template<class _Ty> ctle::status _write_to_stream( ctle::write_stream<ctle::file_data_destination,ctle::hasher_xxh128> &strm, const std::vector<_Ty> &data )
 {
-	ctle::status res = strm.write<u32>( (u32)data.size() );
+	ctle::status res = strm.write_varint<u32>( (u32)data.size() );
 	if( !res ) 
   		return res; 
 	return strm.write<_Ty>( data.data(), data.size() );